@@ -0,0 +1,65 @@
+#include "generator.h"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+void generateDataset(const GeneratorOptions& options, const std::string& path_to_csv) {
+  if (options.continuous + options.discrete == 0)
+    throw std::invalid_argument("Dataset needs at least one attribute");
+  if (options.classes == 0 || options.cardinality == 0)
+    throw std::invalid_argument("Dataset needs at least one class and one value per discrete attribute");
+
+  std::ofstream output(path_to_csv, std::ios::binary);
+  if (!output.is_open())
+    throw std::runtime_error("Failed to write the dataset " + path_to_csv);
+
+  std::string line;
+  for (size_t i = 0; i < options.continuous; ++i)
+    line += "c" + std::to_string(i) + ",";
+  for (size_t i = 0; i < options.discrete; ++i)
+    line += "d" + std::to_string(i) + ",";
+  line += "class\n";
+  output << line;
+
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::uniform_int_distribution<size_t> value(0, options.cardinality - 1);
+  std::uniform_int_distribution<size_t> random_class(0, options.classes - 1);
+  char number[32];
+
+  for (size_t row = 0; row < options.rows; ++row) {
+    line.clear();
+    size_t planted = 0;
+
+    for (size_t i = 0; i < options.continuous; ++i) {
+      float x = unit(random);
+      if (i == 0)
+        planted = static_cast<size_t>(x * options.classes);
+      // values are drawn even for empty fields, so the missing fraction does not change the other values
+      if (unit(random) >= options.missing) {
+        std::snprintf(number, sizeof(number), "%.3f", x);
+        line += number;
+      }
+      line += ',';
+    }
+
+    for (size_t i = 0; i < options.discrete; ++i) {
+      size_t code = value(random);
+      if (i == 0 && code == 0)
+        planted += 1;
+      if (unit(random) >= options.missing)
+        line += "v" + std::to_string(code);
+      line += ',';
+    }
+
+    size_t class_index = planted % options.classes;
+    if (unit(random) < options.noise)
+      class_index = random_class(random);
+    line += "class" + std::to_string(class_index) + "\n";
+    output << line;
+  }
+
+  if (!output.good())
+    throw std::runtime_error("Failed to write the dataset " + path_to_csv);
+}
@@ -0,0 +1,24 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <string>
+
+// shape of a synthetic dataset
+// attributes are named c0, c1, ... (continuous, uniform in [0, 1)) and d0, d1, ... (discrete, values v0, v1, ...),
+// the class is named class and its values class0, class1, .... The class of a row is planted by the range of c0,
+// shifted to the next class if d0 is v0, so the learner has rules to find; noise relabels rows with a random class
+struct GeneratorOptions {
+  size_t rows = 100000;
+  size_t continuous = 4; // continuous attributes
+  size_t discrete = 4; // discrete attributes
+  size_t classes = 3;
+  size_t cardinality = 8; // distinct values of every discrete attribute
+  float noise = 0.05f; // fraction of rows with a random class
+  float missing = 0.0f; // fraction of empty attribute fields
+  unsigned seed = 1; // the same options and seed give the same file
+};
+
+void generateDataset(const GeneratorOptions& options, const std::string& path_to_csv); // throws on invalid options or if the file can't be written
+
+#endif
@@ -0,0 +1,349 @@
+// ripperk_bench - micro and end-to-end benchmarks of the learner on synthetic datasets
+// built as the ripperk_bench target of the CMake project, from the sources of the learner and of this directory
+// Every benchmark is run once to warm up, then --samples times. A sample repeats the benchmark until it takes at
+// least --min-time milliseconds, and reports the time of one repetition. The results are printed as a table and
+// written as JSON with --output; an earlier output given with --baseline is compared against by median
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../header/ripperk.h"
+#include "../internal/header/modelfile.h"
+#include "../internal/header/program.h"
+#include "generator.h"
+
+namespace {
+
+struct Result {
+  std::string group; // micro or e2e
+  std::string name;
+  size_t repetitions; // per sample
+  size_t items; // rows or calls handled by one repetition
+  double min_ns; // per repetition
+  double median_ns;
+  double mean_ns;
+};
+
+// read by nothing, written by the benchmarks so that the optimizer keeps their work
+volatile double sink;
+
+// accepts and drops everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// the learner prints its results, which would flood the output of the benchmarks and time the terminal.
+// Output is still formatted, only not written anywhere
+class Silence {
+public:
+  Silence() : saved(std::cout.rdbuf(&this->buffer)) {}
+  ~Silence() { std::cout.rdbuf(this->saved); }
+
+private:
+  NullBuffer buffer;
+  std::streambuf* saved;
+};
+
+class Runner {
+public:
+  Runner(const std::string& filter, size_t samples, double min_time_ns)
+    : filter(filter)
+    , samples(samples)
+    , min_time_ns(min_time_ns)
+  {}
+
+  // benchmarks whose name does not contain the filter are skipped
+  void run(const std::string& group, const std::string& name, size_t items, const std::function<void()>& body) {
+    if (!this->filter.empty() && (group + "/" + name).find(this->filter) == std::string::npos)
+      return;
+
+    std::cerr << "Running " << group << "/" << name << std::endl;
+    Silence silence;
+    auto time = [&body](size_t repetitions) {
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < repetitions; ++i)
+        body();
+      return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    double warm_up = time(1);
+    size_t repetitions = warm_up >= this->min_time_ns ? 1 : (size_t)std::ceil(this->min_time_ns / std::max(warm_up, 1.0));
+
+    std::vector<double> times;
+    for (size_t i = 0; i < this->samples; ++i)
+      times.push_back(time(repetitions) / repetitions);
+    std::sort(times.begin(), times.end());
+
+    this->results.push_back(Result{group, name, repetitions, items, times.front(), times[times.size() / 2],
+                                   std::accumulate(times.begin(), times.end(), 0.0) / times.size()});
+  }
+
+  const std::vector<Result>& getResults() const {
+    return this->results;
+  }
+
+private:
+  std::string filter;
+  size_t samples;
+  double min_time_ns;
+  std::vector<Result> results;
+};
+
+// a benchmark per line, so that outputs can be read back without a JSON parser
+void writeJson(const std::string& path, const GeneratorOptions& options, unsigned threads, const std::vector<Result>& results) {
+  std::ofstream output(path);
+  if (!output.is_open())
+    throw std::runtime_error("Failed to write the results " + path);
+
+  output << std::fixed << std::setprecision(1);
+  output << "{\n";
+  output << "  \"dataset\": {\"rows\": " << options.rows << ", \"continuous\": " << options.continuous
+         << ", \"discrete\": " << options.discrete << ", \"classes\": " << options.classes
+         << ", \"cardinality\": " << options.cardinality << ", \"noise\": " << std::setprecision(3) << options.noise
+         << ", \"missing\": " << options.missing << ", \"seed\": " << options.seed << "},\n" << std::setprecision(1);
+  output << "  \"threads\": " << threads << ",\n";
+  output << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    output << "    {\"group\": \"" << result.group << "\", \"name\": \"" << result.name << "\", \"repetitions\": " << result.repetitions
+           << ", \"items\": " << result.items << ", \"min_ns\": " << result.min_ns << ", \"median_ns\": " << result.median_ns
+           << ", \"mean_ns\": " << result.mean_ns << ", \"median_ns_per_item\": " << result.median_ns / std::max<size_t>(result.items, 1)
+           << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  output << "  ]\n";
+  output << "}\n";
+}
+
+// medians of an output of writeJson by group/name
+std::map<std::string, double> readBaseline(const std::string& path) {
+  std::ifstream input(path);
+  if (!input.is_open())
+    throw std::runtime_error("Failed to read the baseline " + path);
+
+  auto field = [](const std::string& line, const std::string& key) {
+    auto start = line.find("\"" + key + "\": ");
+    if (start == std::string::npos)
+      return std::string();
+    start += key.size() + 4;
+    if (line[start] == '"')
+      return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+    return line.substr(start, line.find_first_of(",}", start) - start);
+  };
+
+  std::map<std::string, double> medians;
+  std::string line;
+  while (std::getline(input, line)) {
+    auto median = field(line, "median_ns");
+    if (!median.empty())
+      medians[field(line, "group") + "/" + field(line, "name")] = std::stod(median);
+  }
+  return medians;
+}
+
+void printResults(const std::vector<Result>& results, const std::map<std::string, double>& baseline) {
+  std::cout << std::left << std::setw(32) << "Benchmark" << std::setw(14) << "Repetitions" << std::setw(16) << "Median ms"
+            << std::setw(16) << "ns per item" << (baseline.empty() ? "" : "Change") << std::endl;
+  for (const auto& result: results) {
+    auto name = result.group + "/" + result.name;
+    std::cout << std::setw(32) << name << std::setw(14) << result.repetitions << std::setw(16) << result.median_ns / 1e6
+              << std::setw(16) << result.median_ns / std::max<size_t>(result.items, 1);
+
+    // a positive change is a slowdown
+    auto it = baseline.find(name);
+    if (it != baseline.end() && it->second > 0)
+      std::cout << std::showpos << (result.median_ns / it->second - 1) * 100 << "%" << std::noshowpos;
+    std::cout << std::endl;
+  }
+}
+
+void printHelp() {
+  std::cout << "--rows - rows of the generated training and test datasets. Default is 100000" << std::endl;
+  std::cout << "--continuous - continuous attributes. Default is 4" << std::endl;
+  std::cout << "--discrete - discrete attributes. Default is 4" << std::endl;
+  std::cout << "--classes - number of classes. Default is 3" << std::endl;
+  std::cout << "--cardinality - distinct values of every discrete attribute. Default is 8" << std::endl;
+  std::cout << "--noise - fraction of rows with a random class. Default is 0.05" << std::endl;
+  std::cout << "--missing - fraction of empty attribute fields. Default is 0" << std::endl;
+  std::cout << "--seed - seed of the generator. Default is 1" << std::endl;
+  std::cout << "--ratio - ratio of grow to prune dataset. Default is 2/3" << std::endl;
+  std::cout << "--k - number of times the optimization is performed. Default is 2" << std::endl;
+  std::cout << "--threads - number of threads, 0 uses all hardware threads. Default is 1" << std::endl;
+  std::cout << "--samples - timed samples of every benchmark. Default is 5" << std::endl;
+  std::cout << "--min-time - minimal duration of a sample in milliseconds. Default is 200" << std::endl;
+  std::cout << "--filter - run only the benchmarks whose group/name contains the text" << std::endl;
+  std::cout << "--workdir - directory of the generated files. Default is ripperk_bench in the temporary directory" << std::endl;
+  std::cout << "--output - path to the JSON file the results are written to. Non-mandatory" << std::endl;
+  std::cout << "--baseline - path to an earlier JSON output to compare the results with. Non-mandatory" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::map<std::string, std::string> params;
+  for (int i = 1; i < argc; ++i) {
+    std::string param = argv[i];
+    if (param == "--help") {
+      printHelp();
+      return 0;
+    }
+    if (param.rfind("--", 0) != 0 || i + 1 == argc) {
+      std::cerr << "Incorrect parameter " << param << ", see --help" << std::endl;
+      return 1;
+    }
+    params[param] = argv[++i];
+  }
+
+  auto param = [&params](const std::string& name, const std::string& default_value) {
+    auto it = params.find(name);
+    return it == params.end() ? default_value : it->second;
+  };
+
+  GeneratorOptions options;
+  options.rows = std::stoul(param("--rows", "100000"));
+  options.continuous = std::stoul(param("--continuous", "4"));
+  options.discrete = std::stoul(param("--discrete", "4"));
+  options.classes = std::stoul(param("--classes", "3"));
+  options.cardinality = std::stoul(param("--cardinality", "8"));
+  options.noise = std::stof(param("--noise", "0.05"));
+  options.missing = std::stof(param("--missing", "0"));
+  options.seed = std::stoul(param("--seed", "1"));
+  float pruning_ratio = params.count("--ratio") ? std::stof(params["--ratio"]) : 2/(float)3;
+  int k = std::stoi(param("--k", "2"));
+  unsigned threads = std::stoul(param("--threads", "1"));
+  Runner runner(param("--filter", ""), std::max<size_t>(std::stoul(param("--samples", "5")), 1), std::stod(param("--min-time", "200")) * 1e6);
+
+  std::filesystem::path workdir = param("--workdir", (std::filesystem::temp_directory_path() / "ripperk_bench").generic_string());
+  std::filesystem::create_directories(workdir);
+  auto path_to_train = (workdir / "train.csv").generic_string();
+  auto path_to_test = (workdir / "test.csv").generic_string();
+  auto path_to_cache = (workdir / "train.cache").generic_string();
+  auto path_to_model_bin = (workdir / "model.bin").generic_string();
+  auto path_to_fit_bin = (workdir / "fit.bin").generic_string();
+
+  // the test dataset has the shape of the training dataset and rows of its own
+  std::cerr << "Generating the datasets in " << workdir.generic_string() << std::endl;
+  generateDataset(options, path_to_train);
+  auto test_options = options;
+  test_options.seed += 1;
+  generateDataset(test_options, path_to_test);
+
+  ThreadPool pool(threads);
+  const Dataset dataset(path_to_train, &pool);
+  dataset.write(path_to_cache);
+  const auto attr_manager = std::make_shared<const AttributeManager>(dataset);
+  {
+    Silence silence;
+    RIPPERk(path_to_train, "", path_to_model_bin, pruning_ratio, k, threads).fit();
+  }
+
+  // the first class against the others, split into the grow and prune sets the way IREP does
+  RowIds pos_rows, neg_rows, all_rows(dataset.size());
+  std::iota(all_rows.begin(), all_rows.end(), 0);
+  for (size_t row = 0; row < dataset.size(); ++row)
+    (dataset.getClassColumn()[row] == 0 ? pos_rows : neg_rows).push_back(row);
+  const RowView pos(std::move(pos_rows)), neg(std::move(neg_rows)), rows(std::move(all_rows));
+  auto grow_size = [pruning_ratio](const RowView& view) {
+    return std::min<size_t>(std::floor(view.size() * pruning_ratio) + 1, view.size());
+  };
+  const auto grow_pos = pos.subview(0, grow_size(pos)), prune_pos = pos.subview(grow_size(pos), pos.size() - grow_size(pos));
+  const auto grow_neg = neg.subview(0, grow_size(neg)), prune_neg = neg.subview(grow_size(neg), neg.size() - grow_size(neg));
+
+  Rule grown(attr_manager);
+  grown.grow(dataset, grow_pos, grow_neg, &pool);
+
+  // a few grown and pruned rules for the first class, as IREP would add them
+  Ruleset ruleset;
+  for (RowView uncovered_pos = pos; ruleset.size() < 8 && !uncovered_pos.empty();) {
+    Rule rule(attr_manager);
+    rule.grow(dataset, uncovered_pos.subview(0, grow_size(uncovered_pos)), grow_neg, &pool);
+    rule.prune(dataset, uncovered_pos.subview(grow_size(uncovered_pos), uncovered_pos.size() - grow_size(uncovered_pos)), prune_neg);
+    if (rule.empty())
+      break;
+    ruleset.addRule(rule);
+    uncovered_pos = rule.uncovered(dataset, uncovered_pos);
+  }
+
+  std::vector<float> counts(4 * 4096);
+  std::mt19937 random(options.seed);
+  std::generate(counts.begin(), counts.end(), [&random]() { return (float)(random() % 10000); });
+
+  const Program program = ModelFile(path_to_model_bin).compile(dataset);
+  std::vector<std::uint32_t> classes(dataset.size());
+
+  runner.run("micro", "foil_gain", counts.size() / 4, [&]() {
+    float sum = 0.0f;
+    for (size_t i = 0; i < counts.size(); i += 4)
+      sum += Rule::foil_gain(counts[i] + counts[i + 1], counts[i + 1], counts[i + 2], counts[i + 3]);
+    sink = sum;
+  });
+  runner.run("micro", "rule_cover", rows.size(), [&]() {
+    sink = grown.cover(dataset, rows);
+  });
+  runner.run("micro", "rule_grow", grow_pos.size() + grow_neg.size(), [&]() {
+    Rule rule(attr_manager);
+    rule.grow(dataset, grow_pos, grow_neg, &pool);
+    sink = rule.size();
+  });
+  runner.run("micro", "rule_prune", prune_pos.size() + prune_neg.size(), [&]() {
+    Rule rule(grown);
+    rule.prune(dataset, prune_pos, prune_neg);
+    sink = rule.size();
+  });
+  runner.run("micro", "ruleset_dl", rows.size(), [&]() {
+    sink = ruleset.dl(dataset, pos, neg);
+  });
+  runner.run("micro", "produce_dataset", dataset.size(), [&]() {
+    Dataset loaded(path_to_train, &pool);
+    sink = AttributeManager(loaded).size();
+  });
+  runner.run("micro", "produce_dataset_cache", dataset.size(), [&]() {
+    Dataset loaded(path_to_cache, &pool);
+    sink = AttributeManager(loaded).size();
+  });
+  runner.run("micro", "model_load", 1, [&]() {
+    sink = ModelFile(path_to_model_bin).compile(dataset).getClassCount();
+  });
+  runner.run("micro", "classify_row", dataset.size(), [&]() {
+    size_t sum = 0;
+    for (size_t row = 0; row < dataset.size(); ++row)
+      sum += program.classify(row);
+    sink = sum;
+  });
+  runner.run("micro", "classify_batch", dataset.size(), [&]() {
+    program.classify(0, dataset.size(), classes.data());
+    sink = classes.back();
+  });
+
+  runner.run("e2e", "fit", dataset.size(), [&]() {
+    RIPPERk(path_to_train, "", path_to_fit_bin, pruning_ratio, k, threads).fit();
+  });
+  runner.run("e2e", "evaluate", test_options.rows, [&]() {
+    RIPPERk(path_to_test, "", path_to_model_bin, pruning_ratio, k, threads).evaluate();
+  });
+  runner.run("e2e", "classify", test_options.rows, [&]() {
+    RIPPERk(path_to_test, "", path_to_model_bin, pruning_ratio, k, threads).classify();
+  });
+
+  std::map<std::string, double> baseline;
+  if (params.count("--baseline"))
+    baseline = readBaseline(params["--baseline"]);
+  printResults(runner.getResults(), baseline);
+  if (params.count("--output"))
+    writeJson(params["--output"], options, threads, runner.getResults());
+
+  return 0;
+}
@@ -4,21 +4,38 @@
 #include <string>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "../internal/header/dataset.h"
 #include "../internal/header/rule.h"
+#include "../internal/header/model.h"
+#include "../internal/header/threadpool.h"
 
 class RIPPERk {
 public:
+  static constexpr size_t stream_chunk_rows = 65536;
+
   RIPPERk(const std::string& path_to_dataset,
           const std::string& path_to_model_txt,
           const std::string& path_to_model_bin,
           float pruning_ratio=2/(float)3,
-          int k=2);
+          int k=2,
+          unsigned threads=0); // 0 means all hardware threads
 
   void fit(); // throw if dataset is missing
   void evaluate(); // throw if dataset or model is missing
-  void classify();
+  void classify(); // reads the dataset in chunks of stream_chunk_rows rows, memory does not depend on its size. A cache is mapped instead
+  std::vector<std::string> predict(); // classes of all rows of the dataset, classified a block of rows at a time
+  void convert(const std::string& path_to_cache); // writes the parsed dataset as a binary cache, usable in place of the CSV
+  // scores rows sent over the Unix domain socket, or over stdin and stdout if no socket is given, until stopped.
+  // See Server for the protocol. The model file is reloaded when it changes
+  void serve(const std::string& path_to_socket="");
+  // trains a model on all but one of the folds and evaluates it on that fold, for every fold. The dataset is loaded
+  // once and the folds are trained concurrently. Rows grouped by class are dealt to the folds in turn
+  void crossval(size_t folds);
+  // trains a model for every pair of pruning ratio and k on the pool and prints them ranked by success rate on the
+  // test dataset, or on the training dataset if none is given, then by DL. Settings that differ in k only share IREP
+  void sweep(const std::vector<float>& pruning_ratios, const std::vector<int>& ks, const std::string& path_to_test_dataset="");
 
 private:
   // TODO: pimpl (consider during the refactoring stage)
@@ -26,13 +43,32 @@ private:
   std::string path_to_model_txt;
   std::string path_to_model_bin;
 
-  std::list<Instance> dataset;
+  Dataset dataset;
   std::shared_ptr<const AttributeManager> attr_manager;
   float pruning_ratio;
   int k;
+  std::unique_ptr<ThreadPool> pool;
+
+  // what one training run learns from: a dataset, its attributes and the rows of it to learn from
+  struct TrainingData {
+    const Dataset& dataset;
+    std::shared_ptr<const AttributeManager> attr_manager;
+    RowView rows;
+    float pruning_ratio;
+    float baseline_dl; // DL of assigning all rows to the class of the last row, the bound IREP starts with
+    bool with_dl; // whether train computes the DL of the models
+  };
+
+  struct TrainedModel {
+    Model model;
+    float dl; // sum of the DLs of the rulesets on their training rows, 0 unless asked for
+  };
 
-  Ruleset IREP(std::list<Instance> pos, std::list<Instance> neg);
-  void optimize(Ruleset& ruleset, std::list<Instance> pos, std::list<Instance> neg); // move to Ruleset?
+  // a model for every k, in the order of ks. The rulesets found by IREP are shared, a model with a larger k
+  // continues the optimization of the one with a smaller k
+  std::vector<TrainedModel> train(const TrainingData& data, const std::vector<int>& ks);
+  Ruleset IREP(const TrainingData& data, RowView pos, RowView neg);
+  void optimize(const TrainingData& data, Ruleset& ruleset, const RowView& pos, const RowView& neg); // move to Ruleset?
   void produceDataset();
 };
 
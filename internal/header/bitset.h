@@ -0,0 +1,72 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <cstdint>
+#include <vector>
+
+#include "dataset.h"
+
+// packed set of dataset rows, one bit per row
+// bulk operations are dispatched at runtime to AVX2 or SSE4.2 kernels if the CPU supports them,
+// otherwise a scalar fallback is used. Bits past size() are always zero
+class Bitset {
+public:
+  using Word = std::uint64_t;
+  static constexpr size_t word_bits = 64;
+
+  Bitset() = default;
+  Bitset(size_t size, bool value=false);
+  Bitset(size_t size, const RowView& rows); // rows are set
+
+  size_t size() const;
+  bool test(size_t i) const;
+  void set(size_t i);
+  void reset(size_t i);
+  size_t count() const;
+  bool any() const;
+  size_t countAnd(const Bitset& other) const; // count of this & other, without materializing it
+  Bitset& operator&=(const Bitset& other);
+  Bitset& operator|=(const Bitset& other);
+  Bitset& andNot(const Bitset& other); // this &= ~other
+  template <typename Function>
+  void forEach(Function function) const; // calls function(row) for every set row, in increasing order
+
+  // masks of the rows of a column satisfying a comparison with a value
+  // NaN and Dataset::missing_code never satisfy it
+  static Bitset equal(const float* column, size_t size, float value);
+  static Bitset lessEqual(const float* column, size_t size, float value);
+  static Bitset moreEqual(const float* column, size_t size, float value);
+  static Bitset equal(const DiscreteCode* column, size_t size, DiscreteCode code);
+
+private:
+  std::vector<Word> words;
+  size_t length = 0;
+
+  void clearTail();
+};
+
+inline size_t Bitset::size() const {
+  return this->length;
+}
+
+inline bool Bitset::test(size_t i) const {
+  return (this->words[i / word_bits] >> (i % word_bits)) & 1;
+}
+
+inline void Bitset::set(size_t i) {
+  this->words[i / word_bits] |= Word(1) << (i % word_bits);
+}
+
+inline void Bitset::reset(size_t i) {
+  this->words[i / word_bits] &= ~(Word(1) << (i % word_bits));
+}
+
+template <typename Function>
+void Bitset::forEach(Function function) const {
+  for (size_t w = 0; w < this->words.size(); ++w) {
+    for (Word word = this->words[w]; word; word &= word - 1)
+      function(w * word_bits + __builtin_ctzll(word));
+  }
+}
+
+#endif
@@ -2,11 +2,18 @@
 #define ATTRIBUTE_H
 
 #include <string>
+#include <string_view>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <vector>
 #include <variant>
+#include <optional>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <fstream>
 
 enum AttributeType {
   NONE, // invalid type
@@ -16,28 +23,344 @@ enum AttributeType {
 
 using AttributeValue = std::variant<std::string, float>; // holds a discrete value as string or a continuous value as float
 
-struct Attribute {
-  std::string name;
-  AttributeType type;
-  AttributeValue value;
+using ClassCode = std::uint16_t; // class labels are encoded as indices into Dataset::getClassNames()
+using DiscreteCode = std::uint32_t; // discrete values are encoded as indices into the dictionary of their column
+using RowIds = std::vector<std::uint32_t>; // subset of the dataset rows, referenced by index
+using AttributeId = std::uint32_t; // dense index of an attribute in AttributeManager
+
+// read-only view of a contiguous array owned by someone else
+template <typename T>
+class Span {
+public:
+  Span() = default;
+  Span(const T* items, size_t count);
+
+  size_t size() const;
+  bool empty() const;
+  const T* data() const;
+  const T* begin() const;
+  const T* end() const;
+  const T& operator[](size_t i) const;
+
+private:
+  const T* items = nullptr;
+  size_t count = 0;
 };
 
-struct Instance {
-  std::string class_value;
+class ThreadPool;
+class MappedFile;
+
+// names, types and dictionaries of the attributes a model was trained on
+// a CSV read against a schema takes them from it instead of guessing them from its rows
+struct Schema {
+  struct Attribute {
+    std::string name;
+    AttributeType type;
+    std::vector<std::string> dictionary; // sorted, discrete attributes only
+  };
+
   std::vector<Attribute> attributes;
 };
 
+// read-only view of a range of row ids
+// views share the ids they refer to, so copying a view or taking a part of it copies no rows
+class RowView {
+public:
+  RowView() = default;
+  RowView(RowIds rows); // takes the ids over
+
+  size_t size() const;
+  bool empty() const;
+  const std::uint32_t* begin() const;
+  const std::uint32_t* end() const;
+  std::uint32_t operator[](size_t i) const;
+  RowView subview(size_t offset, size_t count) const;
+
+private:
+  std::shared_ptr<const RowIds> rows;
+  size_t offset = 0;
+  size_t count = 0;
+};
+
+// column store holding the whole dataset
+// every continuous attribute is kept in one contiguous float column, every discrete attribute is kept
+// as a column of codes into a sorted dictionary of its values. The class (last CSV column) is encoded the same way.
+// A dataset is read from a CSV file or from a binary cache written by write(); the columns of a cache are used
+// directly from the mapped file, only the names and dictionaries are copied
+class Dataset {
+public:
+  static constexpr DiscreteCode missing_code = std::numeric_limits<DiscreteCode>::max(); // empty discrete field. Continuous empty fields are NaN
+  static constexpr std::uint32_t cache_version = 1;
+
+  Dataset() = default;
+  // CSV or binary cache, told apart by the content. Throws if the file can't be read. A CSV is parsed on the pool if given
+  Dataset(const std::string& path, ThreadPool* pool=nullptr);
+  static bool isCache(const std::string& path); // false for CSV files and unreadable files
+
+  void write(const std::string& path_to_cache) const; // throws if the file can't be written
+  // the dataset as if it held the given rows only, for training on a part of it. Rows keep their ids, so the subset has
+  // the size of this dataset; its columns and dictionaries are the ones of this dataset, which has to outlive it, and
+  // only the sorted rows, distinct values and present values are rebuilt over the given rows
+  Dataset subset(const RowView& rows) const;
+
+  size_t size() const; // number of rows
+  size_t getAttributeCount() const; // number of columns, class excluded
+  const std::string& getAttributeName(size_t column) const;
+  AttributeType getAttributeType(size_t column) const;
+  size_t getColumn(const std::string& attr_name) const; // throws if the dataset has no such attribute
+  Span<float> getContinuousColumn(size_t column) const;
+  Span<DiscreteCode> getDiscreteColumn(size_t column) const;
+  Span<std::uint32_t> getSortedRows(size_t column) const; // rows of a continuous column in increasing value order, missing values excluded
+  Span<float> getDistinctValues(size_t column) const; // sorted distinct values of a continuous column, missing values excluded
+  const std::vector<std::string>& getDictionary(size_t column) const; // sorted values the codes of a discrete column index
+  // sorted distinct values of a discrete column, missing values excluded. The dictionary, except for a subset
+  const std::vector<std::string>& getPresentValues(size_t column) const;
+  DiscreteCode encode(size_t column, std::string_view value) const; // missing_code if the value never occurs
+
+  Span<ClassCode> getClassColumn() const;
+  const std::vector<std::string>& getClassNames() const; // sorted, ClassCode is the index
+
+private:
+  friend class DatasetBuilder;
+  friend class RowParser;
+
+  // elements owned by the dataset, or viewed in the mapped cache file
+  template <typename T>
+  struct Array {
+    std::vector<T> owned;
+    Span<T> mapped;
+
+    Span<T> get() const;
+  };
+
+  struct Column {
+    std::string name;
+    AttributeType type;
+    Array<float> continuous;
+    Array<DiscreteCode> discrete;
+    std::vector<std::string> dictionary;
+    std::optional<std::vector<std::string>> present; // values of the rows of a subset, the whole dictionary if not set
+    Array<std::uint32_t> sorted_rows;
+    Array<float> distinct;
+  };
+
+  std::vector<Column> columns;
+  Array<ClassCode> class_column;
+  std::vector<std::string> class_names;
+  size_t rows = 0;
+  std::shared_ptr<const MappedFile> mapping; // keeps the mapped arrays alive, shared by the copies of the dataset
+
+  void readCache(std::shared_ptr<const MappedFile> file);
+};
+
+// reads a CSV file a chunk of rows at a time, so that memory does not depend on the file size
+// every chunk has the types and dictionaries of the schema, values not in a dictionary are stored as missing, as are
+// values that are not a number in a continuous column. Columns the schema does not know hold missing values only.
+// Chunks have no sorted rows, they are meant for classification only
+class DatasetReader {
+public:
+  DatasetReader(const std::string& path_to_csv, size_t chunk_rows, const Schema& schema); // throws if the file can't be read
+  bool next(Dataset& chunk); // reads the next chunk, false if no rows are left
+
+private:
+  std::ifstream input;
+  size_t chunk_rows;
+  std::vector<std::string> names;
+  std::vector<AttributeType> types;
+  std::vector<std::optional<std::vector<std::string>>> dictionaries; // per column, the dictionary of a discrete column
+};
+
+// parses CSV rows against a schema a batch at a time, for rows that arrive a few at a time
+// the dictionaries are indexed once, so a batch costs only its rows. Batches carry neither dictionaries nor classes:
+// programs are compiled against getLayout(), which has the columns and dictionaries of every batch, and bound to the batches
+class RowParser {
+public:
+  RowParser(const Schema& schema, std::string_view header); // header is the CSV header naming the columns of the rows
+  RowParser(const RowParser&) = delete;
+  RowParser& operator=(const RowParser&) = delete;
+
+  const Dataset& getLayout() const;
+  void parse(const std::vector<std::string_view>& lines, Dataset& batch); // a row per line
+
+private:
+  Dataset layout; // no rows
+  std::vector<std::unordered_map<std::string_view, DiscreteCode>> codes; // keys view the dictionaries of the layout
+  std::vector<std::string_view> fields;
+};
+
+// schema of the attributes, each attribute gets a dense id in alphabetical order of the names
+// types, columns and value counts are kept in flat arrays indexed by the id, so only name lookups touch a map
 class AttributeManager {
 public:
   AttributeManager() = default;
-  AttributeManager(const std::list<Instance>& dataset);
-  std::list<AttributeValue> getPossibleValues(const std::string& attr_name) const;
-  std::list<std::string> getAttributeNames() const;
-  AttributeType getAttributeType(const std::string &attr_name) const;
+  AttributeManager(const Dataset& dataset);
+
+  size_t size() const; // number of attributes
+  AttributeId getId(const std::string& attr_name) const; // throws if not found
+  const std::string& getName(AttributeId id) const;
+  AttributeType getAttributeType(AttributeId id) const;
+  size_t getColumn(AttributeId id) const; // column of the attribute in the dataset
+  size_t getValueCount() const; // sum of the cardinalities of all attributes
+  Span<std::string> getDiscreteValues(AttributeId id) const; // sorted distinct values, empty for continuous attributes
 
 private:
-  std::map<std::string, std::set<AttributeValue>> possible_attr_values;
-  std::map<std::string, AttributeType> attribute_types;
+  std::vector<std::string> names;
+  std::vector<AttributeType> types;
+  std::vector<size_t> columns;
+  std::vector<std::vector<std::string>> discrete_values;
+  std::map<std::string, AttributeId> ids;
+  size_t value_count = 0;
 };
 
-#endif
\ No newline at end of file
+template <typename T>
+Span<T>::Span(const T* items, size_t count)
+  : items(items)
+  , count(count)
+{}
+
+template <typename T>
+size_t Span<T>::size() const {
+  return this->count;
+}
+
+template <typename T>
+bool Span<T>::empty() const {
+  return this->count == 0;
+}
+
+template <typename T>
+const T* Span<T>::data() const {
+  return this->items;
+}
+
+template <typename T>
+const T* Span<T>::begin() const {
+  return this->items;
+}
+
+template <typename T>
+const T* Span<T>::end() const {
+  return this->items + this->count;
+}
+
+template <typename T>
+const T& Span<T>::operator[](size_t i) const {
+  return this->items[i];
+}
+
+inline RowView::RowView(RowIds rows)
+  : rows(std::make_shared<const RowIds>(std::move(rows)))
+  , offset(0)
+  , count(this->rows->size())
+{}
+
+inline size_t RowView::size() const {
+  return this->count;
+}
+
+inline bool RowView::empty() const {
+  return this->count == 0;
+}
+
+inline const std::uint32_t* RowView::begin() const {
+  return this->rows ? this->rows->data() + this->offset : nullptr;
+}
+
+inline const std::uint32_t* RowView::end() const {
+  return begin() + this->count;
+}
+
+inline std::uint32_t RowView::operator[](size_t i) const {
+  return (*this->rows)[this->offset + i];
+}
+
+inline RowView RowView::subview(size_t offset, size_t count) const {
+  RowView view(*this);
+  view.offset += offset;
+  view.count = count;
+  return view;
+}
+
+inline size_t Dataset::size() const {
+  return this->rows;
+}
+
+inline size_t Dataset::getAttributeCount() const {
+  return this->columns.size();
+}
+
+inline const std::string& Dataset::getAttributeName(size_t column) const {
+  return this->columns[column].name;
+}
+
+inline AttributeType Dataset::getAttributeType(size_t column) const {
+  return this->columns[column].type;
+}
+
+template <typename T>
+Span<T> Dataset::Array<T>::get() const {
+  return this->mapped.data() ? this->mapped : Span<T>(this->owned.data(), this->owned.size());
+}
+
+inline Span<float> Dataset::getContinuousColumn(size_t column) const {
+  return this->columns[column].continuous.get();
+}
+
+inline Span<DiscreteCode> Dataset::getDiscreteColumn(size_t column) const {
+  return this->columns[column].discrete.get();
+}
+
+inline Span<std::uint32_t> Dataset::getSortedRows(size_t column) const {
+  return this->columns[column].sorted_rows.get();
+}
+
+inline Span<float> Dataset::getDistinctValues(size_t column) const {
+  return this->columns[column].distinct.get();
+}
+
+inline const std::vector<std::string>& Dataset::getDictionary(size_t column) const {
+  return this->columns[column].dictionary;
+}
+
+inline const std::vector<std::string>& Dataset::getPresentValues(size_t column) const {
+  const auto& present = this->columns[column].present;
+  return present ? *present : this->columns[column].dictionary;
+}
+
+inline Span<ClassCode> Dataset::getClassColumn() const {
+  return this->class_column.get();
+}
+
+inline const std::vector<std::string>& Dataset::getClassNames() const {
+  return this->class_names;
+}
+
+inline const Dataset& RowParser::getLayout() const {
+  return this->layout;
+}
+
+inline size_t AttributeManager::size() const {
+  return this->names.size();
+}
+
+inline const std::string& AttributeManager::getName(AttributeId id) const {
+  return this->names[id];
+}
+
+inline AttributeType AttributeManager::getAttributeType(AttributeId id) const {
+  return this->types[id];
+}
+
+inline size_t AttributeManager::getColumn(AttributeId id) const {
+  return this->columns[id];
+}
+
+inline size_t AttributeManager::getValueCount() const {
+  return this->value_count;
+}
+
+inline Span<std::string> AttributeManager::getDiscreteValues(AttributeId id) const {
+  return Span<std::string>(this->discrete_values[id].data(), this->discrete_values[id].size());
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+
+namespace Json
+{
+  // the text as a JSON string literal, quotes included. Quotes, backslashes and control characters are escaped
+  std::string quote(std::string_view text);
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// read-only view of a whole file
+// the file is memory-mapped where the platform allows it, otherwise it is read into memory
+class MappedFile {
+public:
+  MappedFile(const std::string& path); // throws if the file can't be read
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const;
+  size_t size() const;
+
+private:
+  const char* mapped = nullptr; // nullptr if the file is empty or was read into buffer
+  size_t length = 0;
+  std::vector<char> buffer;
+};
+
+inline const char* MappedFile::data() const {
+  return this->mapped ? this->mapped : this->buffer.data();
+}
+
+inline size_t MappedFile::size() const {
+  return this->length;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef MDL_H
+#define MDL_H
+
+#include <vector>
+
+#include "rule.h"
+
+// description length of a ruleset on fixed pos and neg instances, kept up to date rule by rule
+// for every rule it remembers the rule's coverage, the instances left uncovered by the rules before it
+// and the DL the rule contributes. Adding a rule only computes that rule, replacing rule i only recomputes
+// the rules from i on, and those use the cached coverages instead of scanning the dataset again
+class DLEvaluator {
+public:
+  DLEvaluator(const Dataset& dataset, const RowView& pos, const RowView& neg);
+  DLEvaluator(const Dataset& dataset, const RowView& pos, const RowView& neg, const Ruleset& ruleset);
+
+  float dl() const; // DL of the rules added so far
+  size_t size() const;
+  float add(const Rule& rule); // appends a rule and returns the new DL
+  void replace(size_t index, const Rule& rule);
+  float dlWith(size_t index, const Rule& rule) const; // DL if the rule at index was replaced. Safe to call concurrently
+
+private:
+  struct Entry {
+    Bitset covered; // coverage of the rule on the whole dataset
+    Bitset pos; // pos instances not covered by the previous rules
+    Bitset neg;
+    float rule_dl; // Rule::dl, depends on the rule only
+    float dl_before; // DL of the previous rules
+  };
+
+  const Dataset& dataset;
+  std::vector<Entry> entries;
+  Bitset residual_pos; // pos instances not covered by any rule
+  Bitset residual_neg;
+  float total = 0.0f;
+
+  // appends an entry for the given rule coverage, continuing from the residual instances
+  void append(Bitset covered, float rule_dl);
+};
+
+inline float DLEvaluator::dl() const {
+  return this->total;
+}
+
+inline size_t DLEvaluator::size() const {
+  return this->entries.size();
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// counters and phase timers of the training, to tell where its time goes
+// built in only if RIPPERK_METRICS is defined. Without it the METRICS_ macros expand to nothing, so the
+// instrumented code compiles to the same code as before and the Metrics class does not exist
+#ifdef RIPPERK_METRICS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// everything is recorded per class: a Scope names the class the thread works for, and the loops the thread runs
+// on a ThreadPool work for the same class. Work outside of any class, such as loading the dataset, only counts
+// in the total. Phase times are inclusive wall times summed over the threads, so a phase running on two threads
+// at once counts twice. Classes of every model trained by the process are merged by name
+class Metrics {
+public:
+  enum Counter {
+    CANDIDATES, // conditions scored while growing
+    COVER_CALLS,
+    ROWS_SCANNED, // rows visited by cover calls and by candidate scans
+    RULES_ADDED, // rules that entered a ruleset, in IREP or as a replacement in optimize
+    RULES_REJECTED, // grown rules that were discarded
+    counter_count
+  };
+
+  enum Phase {
+    PRODUCE_DATASET,
+    FIT,
+    CLASS, // IREP and optimization of one class
+    IREP,
+    OPTIMIZE,
+    GROW,
+    PRUNE,
+    DL, // DLEvaluator updates, which Ruleset::dl is made of. Coverage passes count as cover calls
+    phase_count
+  };
+
+  struct Record {
+    std::atomic<std::uint64_t> counters[counter_count] = {};
+    std::atomic<std::uint64_t> phase_calls[phase_count] = {};
+    std::atomic<std::uint64_t> phase_ns[phase_count] = {};
+  };
+
+  // makes a class current on this thread until destroyed
+  class Scope {
+  public:
+    Scope(const std::string& class_name);
+    Scope(Record* record); // the class of another thread, as returned by current()
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Record* previous;
+  };
+
+  // adds the wall time from construction to destruction to a phase of the current class
+  class PhaseTimer {
+  public:
+    PhaseTimer(Phase phase);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  private:
+    Record* record;
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  static Record* current(); // record of the current class of this thread
+  static void count(Counter counter, std::uint64_t n);
+  static void write(const std::string& path); // JSON of the total and of every class. Throws if the file can't be written
+
+private:
+  static Record* record(const std::string& class_name); // created on first use, never moved or freed
+};
+
+inline void Metrics::count(Counter counter, std::uint64_t n) {
+  current()->counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+#define METRICS_JOIN_(a, b) a##b
+#define METRICS_JOIN(a, b) METRICS_JOIN_(a, b)
+#define METRICS_CLASS(class_name) Metrics::Scope METRICS_JOIN(metrics_scope_, __LINE__)(class_name)
+#define METRICS_PHASE(phase) Metrics::PhaseTimer METRICS_JOIN(metrics_phase_, __LINE__)(Metrics::phase)
+#define METRICS_COUNT(counter, n) Metrics::count(Metrics::counter, n)
+
+#else
+
+#define METRICS_CLASS(class_name)
+#define METRICS_PHASE(phase)
+#define METRICS_COUNT(counter, n)
+
+#endif
+
+#endif
@@ -17,7 +17,7 @@ public:
   void setClassOrder(const std::map<std::string, size_t>& class_order);
   const std::list<std::string>& getClassOrder() const;
   void write(const std::string& path_to_model_txt, const std::string& path_to_model_bin) const;
-  void read(const std::string& path_to_model_bin);
+  Program compile(const Dataset& dataset) const; // throws if the dataset lacks an attribute of the rules. Written models are read by ModelFile
 private:
   std::map<std::string, Ruleset> model;
   std::list<std::string> class_order;
@@ -0,0 +1,107 @@
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "dataset.h"
+#include "program.h"
+
+class MappedFile;
+
+// binary model file, mapped and used in place
+// the file starts with a fixed size header holding the offset and element count of every section. Sections are
+// flat arrays of fixed size records in the byte order of the writer, so loading a model only validates the header.
+// Conditions of a rule, rules of a class and classes are contiguous, in the order they are tried.
+// The model carries the schema of the dataset it was trained on, so data can be read against it without a pass over it
+class ModelFile {
+public:
+  static constexpr char magic[8] = {'R', 'I', 'P', 'K', 'M', 'O', 'D', 'L'};
+  static constexpr std::uint32_t version = 2;
+  static constexpr std::uint32_t byte_order_mark = 0x01020304;
+  static constexpr size_t alignment = 8; // sections start at a multiple of it
+
+  struct Section {
+    std::uint64_t offset; // from the start of the file
+    std::uint64_t count; // elements, not bytes
+  };
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order_mark;
+    Section conditions; // Condition
+    Section rule_ends; // uint32_t, one past the last condition of each rule
+    Section class_ends; // uint32_t, one past the last rule of each class
+    Section class_names; // uint32_t string index per class, followed by the default class
+    Section attributes; // Attribute, every attribute of the training dataset
+    Section dictionary; // uint32_t string index, the sorted values of the discrete attributes one after another
+    Section strings; // StringRef
+    Section text; // char, the bytes of all strings
+  };
+
+  struct Condition {
+    std::uint32_t attribute; // index into the attributes section
+    std::uint8_t cond_operator; // ConditionOperator
+    std::uint8_t reserved[3];
+    union {
+      float threshold; // continuous attributes
+      std::uint32_t value; // code of the value in the dictionary of discrete attributes
+    };
+  };
+
+  struct Attribute {
+    std::uint32_t name; // string index
+    std::uint8_t type; // AttributeType
+    std::uint8_t reserved[3];
+    std::uint32_t dictionary_offset; // first value in the dictionary section, discrete attributes only
+    std::uint32_t dictionary_size;
+  };
+
+  struct StringRef {
+    std::uint32_t offset; // into the text section
+    std::uint32_t length;
+  };
+
+  ModelFile(const std::string& path); // throws if the file can't be read or is not a model of this version
+
+  size_t getClassCount() const; // classes with rules, the default class excluded
+  std::string_view getClassName(size_t index) const; // index getClassCount() is the default class
+  Schema getSchema() const; // attributes of the training dataset
+  // loading only maps the file, compiling is the one step whose cost grows with the model: once per dataset, one op per
+  // condition. The attributes are resolved by name and the discrete values by the dictionaries of the dataset
+  Program compile(const Dataset& dataset) const; // throws if the dataset lacks an attribute or has it with a different type
+  // for a dataset read against getSchema(): its discrete codes are the codes of the model, so the conditions are
+  // copied without looking up any value
+  Program compileForSchema(const Dataset& dataset) const;
+
+private:
+  std::shared_ptr<const MappedFile> file; // shared by the copies of the model
+  Span<Condition> conditions;
+  Span<std::uint32_t> rule_ends;
+  Span<std::uint32_t> class_ends;
+  Span<std::uint32_t> class_names;
+  Span<Attribute> attributes;
+  Span<std::uint32_t> dictionary;
+  Span<StringRef> strings;
+  Span<char> text;
+
+  template <typename T>
+  Span<T> section(const Section& section) const; // throws if the section is out of the file or misaligned
+  std::string_view string(std::uint32_t index) const; // throws if the index or the string is out of range
+  std::string_view value(const Attribute& attribute, std::uint32_t code) const; // throws if the code is out of range
+  Program compile(const Dataset& dataset, bool schema_codes) const;
+};
+
+static_assert(sizeof(ModelFile::Header) == 144, "model header layout");
+static_assert(sizeof(ModelFile::Condition) == 12, "model condition layout");
+static_assert(sizeof(ModelFile::Attribute) == 16, "model attribute layout");
+static_assert(sizeof(ModelFile::StringRef) == 8, "model string layout");
+
+inline size_t ModelFile::getClassCount() const {
+  return this->class_ends.size();
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "bitset.h"
+
+// model compiled against the columns of one dataset into a flat list of condition ops
+// rules are contiguous ranges of ops and classes are contiguous ranges of rules, both in the order of the model.
+// Attribute names and values are resolved at compile time, so classifying a row only compares numbers
+class Program {
+public:
+  static constexpr size_t block_size = 1024; // rows classified together by the batch classify
+
+  enum OpCode : std::uint8_t {
+    CONTINUOUS_EQ,
+    CONTINUOUS_LESS_EQ,
+    CONTINUOUS_MORE_EQ,
+    DISCRETE_EQ,
+    DISCRETE_LESS_EQ,
+    DISCRETE_MORE_EQ,
+    NEVER // the value does not occur in the dataset, so the condition can't be satisfied
+  };
+
+  struct Op {
+    OpCode code;
+    std::uint32_t column;
+    union {
+      float threshold; // continuous ops
+      DiscreteCode value; // discrete ops
+    };
+  };
+
+  Program() = default;
+  Program(const Dataset& dataset);
+
+  // points the ops at the columns of another dataset with the same columns and codes, such as the next chunk of a
+  // DatasetReader or a batch of RowParser
+  void bind(const Dataset& dataset);
+
+  // rules and classes are appended in the order they are tried
+  void addOp(Op op);
+  void endRule();
+  void endClass(const std::string& class_name);
+  void setDefaultClass(const std::string& class_name);
+
+  // index of the first class with a rule covering the row, or getClassCount() - 1 for the default class
+  size_t classify(size_t row) const;
+  // classifies rows [first_row, first_row + count) into classes[0, count), a block of rows at a time
+  // every op is applied to the whole block with vector compares and the rules are combined as masks,
+  // rows already assigned to a class are left out of the later rules
+  void classify(size_t first_row, size_t count, std::uint32_t* classes) const;
+  size_t getClassCount() const; // classes of the model and the default class
+  const std::string& getClassName(size_t index) const;
+
+private:
+  std::vector<const float*> continuous; // per dataset column, nullptr for discrete columns
+  std::vector<const DiscreteCode*> discrete;
+  std::vector<Op> ops;
+  std::vector<std::uint32_t> rule_ends; // one past the last op of each rule
+  std::vector<std::uint32_t> class_ends; // one past the last rule of each class
+  std::vector<std::string> class_names;
+  std::string default_class_name;
+
+  bool test(const Op& op, size_t row) const;
+  Bitset mask(const Op& op, size_t first_row, size_t size) const; // rows of the block satisfying the op
+  void classifyBlock(size_t first_row, size_t size, std::uint32_t* classes) const;
+};
+
+inline bool Program::test(const Op& op, size_t row) const {
+  // missing values (NaN or missing_code) never satisfy an op. missing_code is the largest code,
+  // so only >= has to check for it
+  switch (op.code) {
+    case CONTINUOUS_EQ:
+      return this->continuous[op.column][row] == op.threshold;
+    case CONTINUOUS_LESS_EQ:
+      return this->continuous[op.column][row] <= op.threshold;
+    case CONTINUOUS_MORE_EQ:
+      return this->continuous[op.column][row] >= op.threshold;
+    case DISCRETE_EQ:
+      return this->discrete[op.column][row] == op.value;
+    case DISCRETE_LESS_EQ:
+      return this->discrete[op.column][row] <= op.value;
+    case DISCRETE_MORE_EQ: {
+      auto value = this->discrete[op.column][row];
+      return value != Dataset::missing_code && value >= op.value;
+    }
+    default:
+      return false;
+  }
+}
+
+inline size_t Program::classify(size_t row) const {
+  size_t op = 0;
+  size_t rule = 0;
+
+  for (size_t class_index = 0; class_index < this->class_ends.size(); ++class_index) {
+    for (; rule < this->class_ends[class_index]; ++rule) {
+      size_t end = this->rule_ends[rule];
+      while (op < end && test(this->ops[op], row))
+        ++op;
+      if (op == end)
+        return class_index; // every op of the rule passed, an empty rule covers all rows
+      op = end;
+    }
+  }
+
+  return this->class_ends.size();
+}
+
+inline size_t Program::getClassCount() const {
+  return this->class_names.size() + 1;
+}
+
+inline const std::string& Program::getClassName(size_t index) const {
+  return index < this->class_names.size() ? this->class_names[index] : this->default_class_name;
+}
+
+#endif
@@ -5,8 +5,12 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 
 #include "dataset.h"
+#include "bitset.h"
+#include "threadpool.h"
+#include "program.h"
 
 enum ConditionOperator {
   EQ,       // ==
@@ -16,10 +20,21 @@ enum ConditionOperator {
 
 struct Condition {
   ConditionOperator cond_operator;
-  std::string attr_name;
+  AttributeId attr_id; // id in the AttributeManager of the rule
   AttributeValue attr_value;
+};
+
+// condition resolved against the columns of one dataset, so that it can be applied to a row without any lookups
+struct BoundCondition {
+  ConditionOperator cond_operator;
+  const float* continuous; // nullptr for discrete attributes
+  const DiscreteCode* discrete;
+  float threshold;
+  DiscreteCode code; // Dataset::missing_code if the value does not occur in the dataset
 
-  bool apply(const AttributeValue attribute_value) const;
+  BoundCondition(const Condition& condition, const Dataset& dataset, const AttributeManager& attribute_manager);
+  bool apply(size_t row) const;
+  Bitset mask(size_t size) const; // rows of the dataset satisfying the condition
 };
 
 class Rule {
@@ -29,26 +44,44 @@ public:
   Rule(const Rule& rule);
   Rule& operator=(const Rule& rhs);
 
-  void grow(std::list<Instance> pos, std::list<Instance> neg);
-  void prune(std::list<Instance> pos, std::list<Instance> neg);
+  void grow(const Dataset& dataset, const RowView& pos, const RowView& neg, ThreadPool* pool=nullptr); // candidates are scored on the pool if given
+  void prune(const Dataset& dataset, const RowView& pos, const RowView& neg);
   void addCondition(const Condition& condition);
   void removeLastCondition();
   void removeAllConditions();
   void copy(const Rule& anotherRule);
-  unsigned cover(const std::list<Instance>& instances) const;
-  unsigned cover(const Instance& instance) const;
+  unsigned cover(const Dataset& dataset, const RowView& rows) const;
+  Bitset coverage(const Dataset& dataset) const; // AND of the condition masks
+  // for every row, the index of the first condition it fails or the number of conditions if the rule covers it
+  // a row is covered by the first k conditions of the rule if its index is >= k
+  std::vector<unsigned> firstFailures(const Dataset& dataset, const RowView& rows) const;
+  RowView uncovered(const Dataset& dataset, const RowView& rows) const; // the rows this rule does not cover
+  void compile(const Dataset& dataset, Program& program) const; // appends the rule to the program, attributes are found by name
   float dl() const;
-  float dl_err(const std::list<Instance>& pos, const std::list<Instance>& neg) const;
+  float dl_err(const Dataset& dataset, const RowView& pos, const RowView& neg) const;
+  static float dl_err(const Bitset& covered, const Bitset& pos, const Bitset& neg);
+  static float dl_err(unsigned covered_pos, unsigned covered_neg, size_t pos_size, size_t neg_size);
+  static float foil_gain(float p, float n, float p_new, float n_new); // p and n are covered by the rule, p_new and n_new by the condition
+  size_t size() const; // number of conditions
   std::string toString() const;
   bool empty() const;
-  void write_bin(std::ofstream& model_bin) const;
-  void read_bin(std::ifstream& model_bin);
+  const std::vector<Condition>& getConditions() const;
 private:
   std::vector<Condition> conditions;
   // const AttributeManager& attribute_manager;
   std::shared_ptr<const AttributeManager> attribute_manager;
 
-  float foil_gain(const Condition& condition, const std::list<Instance>& pos, const std::list<Instance>& neg) const;
+  // best condition found so far while growing. On ties the first one found wins
+  struct Candidate {
+    std::optional<float> gain;
+    Condition condition{};
+
+    bool improvedBy(float new_gain) const;
+  };
+
+  std::vector<BoundCondition> bind(const Dataset& dataset) const;
+  void scanThresholds(const Dataset& dataset, AttributeId attr_id, const Bitset& covered_pos, const Bitset& covered_neg, Candidate& best) const;
+  void scanValues(const Dataset& dataset, AttributeId attr_id, const Bitset& covered_pos, const Bitset& covered_neg, Candidate& best) const;
 };
 
 class Ruleset {
@@ -62,14 +95,56 @@ public:
   void replaceRule(RuleHandle handle, const Rule& rule);
   std::vector<RuleHandle> get() const;
   unsigned size() const;
-  float dl(std::list<Instance> pos, std::list<Instance> neg) const;
+  float dl(const Dataset& dataset, const RowView& pos, const RowView& neg) const;
   std::string toString() const;
-  void pruneRule(RuleHandle handle, std::list<Instance> pos, std::list<Instance> neg);
-  bool cover(const Instance& instance);
-  void simplify(std::list<Instance> pos, std::list<Instance> neg);
+  void pruneRule(RuleHandle handle, const Dataset& dataset, const RowView& pos, const RowView& neg);
+  void simplify(const RowView& pos, const RowView& neg);
 
 private:
   std::vector<Rule> rules; // vector of unique_ptrs ? this must be the ONLY place where the rules are stored
 };
 
+inline size_t Rule::size() const {
+  return this->conditions.size();
+}
+
+inline const std::vector<Condition>& Rule::getConditions() const {
+  return this->conditions;
+}
+
+inline bool Rule::Candidate::improvedBy(float new_gain) const {
+  // conditions that do not increase the gain are not even considered
+  return new_gain > 0.0f && (!this->gain.has_value() || new_gain > this->gain.value());
+}
+
+inline bool BoundCondition::apply(size_t row) const {
+  // missing values (NaN or missing_code) never satisfy a condition
+  if (this->continuous) {
+    switch (this->cond_operator) {
+      case EQ:
+        return this->continuous[row] == this->threshold;
+      case LESS_EQ:
+        return this->continuous[row] <= this->threshold;
+      case MORE_EQ:
+        return this->continuous[row] >= this->threshold;
+      default:
+        return false;
+    }
+  }
+
+  if (this->code == Dataset::missing_code || this->discrete[row] == Dataset::missing_code)
+    return false;
+
+  switch (this->cond_operator) {
+    case EQ:
+      return this->discrete[row] == this->code;
+    case LESS_EQ: // dictionaries are sorted, so the codes are ordered as the values
+      return this->discrete[row] <= this->code;
+    case MORE_EQ:
+      return this->discrete[row] >= this->code;
+    default:
+      return false;
+  }
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "dataset.h"
+#include "modelfile.h"
+
+// scores rows with a model loaded once
+// a client sends the CSV header of its rows first, then one row per line, the class may be left out. It gets back
+// the class name of every row, one per line and in order. Blank lines are ignored. Rows that arrive together are
+// classified as one batch, so a busy client pays the fixed costs once per batch rather than once per row.
+// The model file is watched, and when it changes the new version is swapped in: a batch is always classified
+// by the model it started with, later batches by the new one
+class Server {
+public:
+  static constexpr std::chrono::milliseconds reload_interval{100}; // how often the model file is checked for changes
+  static constexpr size_t max_batch_rows = 4096;
+
+  Server(const std::string& path_to_model_bin); // throws if the model can't be read
+  ~Server(); // stops watching the model
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  void serve(int input, int output); // one client over a pair of file descriptors, returns at the end of the input
+  void listen(const std::string& path_to_socket); // clients of a Unix domain socket, each on a thread of its own. Never returns
+
+private:
+  struct LoadedModel {
+    std::filesystem::file_time_type time; // taken before the file is read, so that a later change is not missed
+    ModelFile file;
+    Schema schema;
+
+    LoadedModel(const std::string& path);
+  };
+
+  std::string path_to_model_bin;
+  std::shared_ptr<const LoadedModel> model; // read and replaced with the atomic shared_ptr functions
+  std::mutex watcher_mutex;
+  std::condition_variable watcher_wakeup;
+  bool stopping = false;
+  std::thread watcher; // last, it starts once the members it uses exist
+
+  void watch();
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads executing parallel loops
+// the calling thread takes part in every loop, so loops may be nested: a loop started from inside
+// another loop's body never waits for a free worker. A pool of size 1 has no workers and runs everything inline
+class ThreadPool {
+public:
+  ThreadPool(size_t threads); // total number of threads including the caller, 0 means all hardware threads
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const;
+  // calls body(i) for every i in [0, n) and returns when all calls are done
+  // the order of the calls is unspecified. The first exception thrown by body is rethrown
+  void parallelFor(size_t n, const std::function<void(size_t)>& body);
+
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable task_available;
+  bool stopping = false;
+
+  void work();
+};
+
+inline size_t ThreadPool::size() const {
+  return this->workers.size() + 1;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+// timeline of the training in the Chrome trace event format, to be opened in a trace viewer such as Perfetto
+// every TRACE_SCOPE records a begin event where it is declared and an end event where it goes out of scope, on the
+// thread it runs on. Nothing is recorded until start() is called; until then a scope costs a check of a flag and its
+// name is not even built. Every thread appends to a buffer of its own, the buffers are only read by write()
+class Trace {
+public:
+  static void start(); // events are recorded from now on, their times are relative to this call
+  static bool enabled();
+  // writes the events of all threads. Call it while no scope is being recorded. Throws if the file can't be written
+  static void write(const std::string& path);
+
+  class Scope {
+  public:
+    Scope(const char* category, std::string name); // records nothing if tracing is not enabled
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    bool recorded;
+  };
+
+private:
+  static std::atomic<bool> recording;
+};
+
+inline bool Trace::enabled() {
+  return recording.load(std::memory_order_relaxed);
+}
+
+#define TRACE_JOIN_(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN_(a, b)
+#define TRACE_SCOPE(category, name) Trace::Scope TRACE_JOIN(trace_scope_, __LINE__)(category, Trace::enabled() ? std::string(name) : std::string())
+
+#endif
@@ -1,40 +1,44 @@
 #include "../header/dataset.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
 
-AttributeManager::AttributeManager(const std::list<Instance>& dataset)
+AttributeManager::AttributeManager(const Dataset& dataset)
 {
-  // std::map<std::string, std::set<AttributeValue>> possible_attr_values;
-  for (const auto& instance: dataset) {
-    for (const auto& attr: instance.attributes) {
-      this->possible_attr_values[attr.name].insert(attr.value);
-      this->attribute_types[attr.name] = attr.type;
+  // ids follow the alphabetical order of the names
+  std::vector<size_t> order(dataset.getAttributeCount());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&dataset](size_t lhs, size_t rhs){return dataset.getAttributeName(lhs) < dataset.getAttributeName(rhs);});
+
+  for (const auto column: order) {
+    const auto& attr_name = dataset.getAttributeName(column);
+    if (this->ids.count(attr_name))
+      continue; // duplicate column name, the first column wins
+
+    std::vector<std::string> discrete;
+    size_t cardinality = 0;
+
+    if (dataset.getAttributeType(column) == CONTINUOUS) {
+      cardinality = dataset.getDistinctValues(column).size();
+    } else {
+      discrete = dataset.getPresentValues(column);
+      cardinality = discrete.size();
     }
-  }
-}
 
-std::list<AttributeValue> AttributeManager::getPossibleValues(const std::string &attr_name) const
-{
-  std::list<AttributeValue> list_of_values;
-  const auto values = this->possible_attr_values.at(attr_name); // throws if not found!
-
-  for (const auto& value: values) {
-    list_of_values.push_back(value);
+    this->ids[attr_name] = this->names.size();
+    this->names.push_back(attr_name);
+    this->types.push_back(dataset.getAttributeType(column));
+    this->columns.push_back(column);
+    this->value_count += cardinality;
+    this->discrete_values.push_back(std::move(discrete));
   }
-
-  return list_of_values;
 }
 
-std::list<std::string> AttributeManager::getAttributeNames() const
+AttributeId AttributeManager::getId(const std::string& attr_name) const
 {
-  std::list<std::string> list_of_names;
+  auto it = this->ids.find(attr_name);
+  if (it == this->ids.end())
+    throw std::runtime_error("Unknown attribute: " + attr_name);
 
-  for (const auto& kv: this->possible_attr_values) {
-    list_of_names.push_back(kv.first);
-  }
-
-  return list_of_names;
-}
-
-AttributeType AttributeManager::getAttributeType(const std::string &attr_name) const
-{
-  return this->attribute_types.at(attr_name); // throws if not found
+  return it->second;
 }
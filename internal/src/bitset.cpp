@@ -0,0 +1,340 @@
+#include "../header/bitset.h"
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RIPPERK_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+  using Word = Bitset::Word;
+
+  // scalar kernels. Also used for the tails the vector kernels leave behind
+
+  void andScalar(Word* dst, const Word* src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] &= src[i];
+  }
+
+  void orScalar(Word* dst, const Word* src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] |= src[i];
+  }
+
+  void andNotScalar(Word* dst, const Word* src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] &= ~src[i];
+  }
+
+  size_t countScalar(const Word* a, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      count += __builtin_popcountll(a[i]);
+    return count;
+  }
+
+  size_t countAndScalar(const Word* a, const Word* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      count += __builtin_popcountll(a[i] & b[i]);
+    return count;
+  }
+
+  // fills whole words starting at row first_word * 64; the last partial word is left to the caller
+  template <typename T, typename Predicate>
+  void compareScalar(const T* column, size_t size, Word* out, size_t first_word, Predicate predicate) {
+    for (size_t row = first_word * Bitset::word_bits; row < size; ++row)
+      if (predicate(column[row]))
+        out[row / Bitset::word_bits] |= Word(1) << (row % Bitset::word_bits);
+  }
+
+#ifdef RIPPERK_X86_KERNELS
+  // AVX2 kernels
+
+  __attribute__((target("avx2")))
+  void andAvx2(Word* dst, const Word* src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(a, b));
+    }
+    andScalar(dst + i, src + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  void orAvx2(Word* dst, const Word* src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(a, b));
+    }
+    orScalar(dst + i, src + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  void andNotAvx2(Word* dst, const Word* src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_andnot_si256(b, a));
+    }
+    andNotScalar(dst + i, src + i, n - i);
+  }
+
+  // nibble lookup popcount of each byte, summed per 64-bit lane (W. Mula)
+  __attribute__((target("avx2")))
+  inline __m256i popcount256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+  }
+
+  __attribute__((target("avx2")))
+  inline size_t sum256(__m256i acc) {
+    return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+  }
+
+  __attribute__((target("avx2")))
+  size_t countAvx2(const Word* a, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+      acc = _mm256_add_epi64(acc, popcount256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i))));
+    return sum256(acc) + countScalar(a + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  size_t countAndAvx2(const Word* a, const Word* b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      acc = _mm256_add_epi64(acc, popcount256(_mm256_and_si256(va, vb)));
+    }
+    return sum256(acc) + countAndScalar(a + i, b + i, n - i);
+  }
+
+  // 8 floats per compare, 8 compares per word
+  template <int predicate>
+  __attribute__((target("avx2")))
+  size_t compareFloatAvx2(const float* column, size_t size, float value, Word* out) {
+    __m256 threshold = _mm256_set1_ps(value);
+    size_t full_words = size / Bitset::word_bits;
+    for (size_t w = 0; w < full_words; ++w) {
+      const float* block = column + w * Bitset::word_bits;
+      Word bits = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        __m256 cmp = _mm256_cmp_ps(_mm256_loadu_ps(block + j * 8), threshold, predicate);
+        bits |= Word(static_cast<unsigned>(_mm256_movemask_ps(cmp))) << (j * 8);
+      }
+      out[w] = bits;
+    }
+    return full_words;
+  }
+
+  __attribute__((target("avx2")))
+  size_t compareCodeAvx2(const DiscreteCode* column, size_t size, DiscreteCode code, Word* out) {
+    __m256i value = _mm256_set1_epi32(static_cast<int>(code));
+    size_t full_words = size / Bitset::word_bits;
+    for (size_t w = 0; w < full_words; ++w) {
+      const DiscreteCode* block = column + w * Bitset::word_bits;
+      Word bits = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        __m256i cmp = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + j * 8)), value);
+        bits |= Word(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(cmp)))) << (j * 8);
+      }
+      out[w] = bits;
+    }
+    return full_words;
+  }
+
+  // SSE4.2 kernels (hardware popcnt, 128-bit compares)
+
+  __attribute__((target("sse4.2,popcnt")))
+  size_t countSse42(const Word* a, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      count += _mm_popcnt_u64(a[i]);
+    return count;
+  }
+
+  __attribute__((target("sse4.2,popcnt")))
+  size_t countAndSse42(const Word* a, const Word* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+      count += _mm_popcnt_u64(a[i] & b[i]);
+    return count;
+  }
+
+  enum SsePredicate { SSE_EQ, SSE_LESS_EQ, SSE_MORE_EQ };
+
+  template <SsePredicate predicate>
+  __attribute__((target("sse4.2")))
+  size_t compareFloatSse42(const float* column, size_t size, float value, Word* out) {
+    __m128 threshold = _mm_set1_ps(value);
+    size_t full_words = size / Bitset::word_bits;
+    for (size_t w = 0; w < full_words; ++w) {
+      const float* block = column + w * Bitset::word_bits;
+      Word bits = 0;
+      for (size_t j = 0; j < 16; ++j) {
+        __m128 v = _mm_loadu_ps(block + j * 4);
+        __m128 cmp = predicate == SSE_EQ ? _mm_cmpeq_ps(v, threshold) : (predicate == SSE_LESS_EQ ? _mm_cmple_ps(v, threshold) : _mm_cmpge_ps(v, threshold));
+        bits |= Word(static_cast<unsigned>(_mm_movemask_ps(cmp))) << (j * 4);
+      }
+      out[w] = bits;
+    }
+    return full_words;
+  }
+
+  __attribute__((target("sse4.2")))
+  size_t compareCodeSse42(const DiscreteCode* column, size_t size, DiscreteCode code, Word* out) {
+    __m128i value = _mm_set1_epi32(static_cast<int>(code));
+    size_t full_words = size / Bitset::word_bits;
+    for (size_t w = 0; w < full_words; ++w) {
+      const DiscreteCode* block = column + w * Bitset::word_bits;
+      Word bits = 0;
+      for (size_t j = 0; j < 16; ++j) {
+        __m128i cmp = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + j * 4)), value);
+        bits |= Word(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(cmp)))) << (j * 4);
+      }
+      out[w] = bits;
+    }
+    return full_words;
+  }
+#endif
+
+  // table of the kernels, selected once for the running CPU
+  struct Kernels {
+    void (*and_words)(Word*, const Word*, size_t) = andScalar;
+    void (*or_words)(Word*, const Word*, size_t) = orScalar;
+    void (*and_not_words)(Word*, const Word*, size_t) = andNotScalar;
+    size_t (*count)(const Word*, size_t) = countScalar;
+    size_t (*count_and)(const Word*, const Word*, size_t) = countAndScalar;
+    // vector compares fill the full words and return their number, the rest is done by compareScalar
+    size_t (*equal)(const float*, size_t, float, Word*) = nullptr;
+    size_t (*less_equal)(const float*, size_t, float, Word*) = nullptr;
+    size_t (*more_equal)(const float*, size_t, float, Word*) = nullptr;
+    size_t (*equal_code)(const DiscreteCode*, size_t, DiscreteCode, Word*) = nullptr;
+  };
+
+  Kernels selectKernels() {
+    Kernels kernels;
+#ifdef RIPPERK_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      kernels.and_words = andAvx2;
+      kernels.or_words = orAvx2;
+      kernels.and_not_words = andNotAvx2;
+      kernels.count = countAvx2;
+      kernels.count_and = countAndAvx2;
+      kernels.equal = compareFloatAvx2<_CMP_EQ_OQ>;
+      kernels.less_equal = compareFloatAvx2<_CMP_LE_OQ>;
+      kernels.more_equal = compareFloatAvx2<_CMP_GE_OQ>;
+      kernels.equal_code = compareCodeAvx2;
+    } else if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+      kernels.count = countSse42;
+      kernels.count_and = countAndSse42;
+      kernels.equal = compareFloatSse42<SSE_EQ>;
+      kernels.less_equal = compareFloatSse42<SSE_LESS_EQ>;
+      kernels.more_equal = compareFloatSse42<SSE_MORE_EQ>;
+      kernels.equal_code = compareCodeSse42;
+    }
+#endif
+    return kernels;
+  }
+
+  const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+  }
+
+  size_t wordsFor(size_t size) {
+    return (size + Bitset::word_bits - 1) / Bitset::word_bits;
+  }
+}
+
+Bitset::Bitset(size_t size, bool value)
+  : words(wordsFor(size), value ? ~Word(0) : Word(0))
+  , length(size)
+{
+  clearTail();
+}
+
+Bitset::Bitset(size_t size, const RowView& rows)
+  : words(wordsFor(size), 0)
+  , length(size)
+{
+  for (const auto row: rows)
+    set(row);
+}
+
+void Bitset::clearTail() {
+  if (this->length % word_bits)
+    this->words.back() &= (Word(1) << (this->length % word_bits)) - 1;
+}
+
+size_t Bitset::count() const {
+  return kernels().count(this->words.data(), this->words.size());
+}
+
+bool Bitset::any() const {
+  return std::any_of(this->words.begin(), this->words.end(), [](Word word){return word != 0;});
+}
+
+size_t Bitset::countAnd(const Bitset& other) const {
+  return kernels().count_and(this->words.data(), other.words.data(), std::min(this->words.size(), other.words.size()));
+}
+
+Bitset& Bitset::operator&=(const Bitset& other) {
+  kernels().and_words(this->words.data(), other.words.data(), std::min(this->words.size(), other.words.size()));
+  return *this;
+}
+
+Bitset& Bitset::operator|=(const Bitset& other) {
+  kernels().or_words(this->words.data(), other.words.data(), std::min(this->words.size(), other.words.size()));
+  return *this;
+}
+
+Bitset& Bitset::andNot(const Bitset& other) {
+  kernels().and_not_words(this->words.data(), other.words.data(), std::min(this->words.size(), other.words.size()));
+  return *this;
+}
+
+Bitset Bitset::equal(const float* column, size_t size, float value) {
+  Bitset mask(size);
+  size_t done = kernels().equal ? kernels().equal(column, size, value, mask.words.data()) : 0;
+  compareScalar(column, size, mask.words.data(), done, [value](float x){return x == value;});
+  return mask;
+}
+
+Bitset Bitset::lessEqual(const float* column, size_t size, float value) {
+  Bitset mask(size);
+  size_t done = kernels().less_equal ? kernels().less_equal(column, size, value, mask.words.data()) : 0;
+  compareScalar(column, size, mask.words.data(), done, [value](float x){return x <= value;});
+  return mask;
+}
+
+Bitset Bitset::moreEqual(const float* column, size_t size, float value) {
+  Bitset mask(size);
+  size_t done = kernels().more_equal ? kernels().more_equal(column, size, value, mask.words.data()) : 0;
+  compareScalar(column, size, mask.words.data(), done, [value](float x){return x >= value;});
+  return mask;
+}
+
+Bitset Bitset::equal(const DiscreteCode* column, size_t size, DiscreteCode code) {
+  Bitset mask(size);
+  if (code == Dataset::missing_code)
+    return mask;
+
+  size_t done = kernels().equal_code ? kernels().equal_code(column, size, code, mask.words.data()) : 0;
+  compareScalar(column, size, mask.words.data(), done, [code](DiscreteCode x){return x == code;});
+  return mask;
+}
@@ -0,0 +1,799 @@
+#include "../header/dataset.h"
+#include "../header/mappedfile.h"
+#include "../header/threadpool.h"
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <charconv>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+  constexpr size_t type_sample_rows = 1024; // rows the attribute types are guessed from before the columns are filled
+  constexpr size_t min_range_bytes = 1 << 20; // smallest part of the file parsed on a thread of its own
+
+  // binary cache layout, all numbers in the byte order of the writer:
+  //   magic | version u32 | byte order mark u32 | rows u64 | attribute count u64
+  //   per attribute: type u8 | name | discrete: dictionary size u64 | values
+  //   class name count u64 | class names
+  //   per attribute, continuous: values f32[rows] | sorted row count u64 | sorted rows u32[] | distinct count u64 | distinct f32[]
+  //                  discrete: codes u32[rows]
+  //   class codes u16[rows]
+  // strings are a length u64 followed by the bytes, arrays start at a multiple of cache_alignment
+  constexpr char cache_magic[8] = {'R', 'I', 'P', 'K', 'D', 'A', 'T', 'A'};
+  constexpr std::uint32_t byte_order_mark = 0x01020304;
+  constexpr size_t cache_alignment = 64;
+
+  class CacheWriter {
+  public:
+    CacheWriter(const std::string& path)
+      : output(path, std::ios::binary)
+    {
+      if (!this->output.is_open())
+        throw std::runtime_error("Failed to open the cache file " + path);
+    }
+
+    template <typename T>
+    void value(T value) {
+      bytes(&value, sizeof(value));
+    }
+
+    void string(const std::string& value) {
+      this->value<std::uint64_t>(value.size());
+      bytes(value.data(), value.size());
+    }
+
+    template <typename T>
+    void array(Span<T> values) {
+      static const char padding[cache_alignment] = {};
+      bytes(padding, (cache_alignment - this->offset % cache_alignment) % cache_alignment);
+      bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void close() {
+      this->output.close();
+      if (this->output.fail())
+        throw std::runtime_error("Failed to write the cache file");
+    }
+
+  private:
+    std::ofstream output;
+    size_t offset = 0;
+
+    void bytes(const void* data, size_t size) {
+      this->output.write(static_cast<const char*>(data), size);
+      this->offset += size;
+    }
+  };
+
+  // reads the cache in place, arrays are views into the file
+  class CacheReader {
+  public:
+    CacheReader(const MappedFile& file)
+      : data(file.data())
+      , size(file.size())
+    {}
+
+    template <typename T>
+    T value() {
+      T value;
+      std::memcpy(&value, take(sizeof(T)), sizeof(T));
+      return value;
+    }
+
+    // number of items that follow, each taking at least item_size bytes, so a corrupted count can't exceed the file
+    size_t count(size_t item_size) {
+      auto count = value<std::uint64_t>();
+      if (count > (this->size - this->offset) / item_size)
+        throw std::runtime_error("Dataset cache is corrupted");
+      return count;
+    }
+
+    std::string string() {
+      auto length = value<std::uint64_t>();
+      return std::string(take(length), length);
+    }
+
+    template <typename T>
+    Span<T> array(size_t count) {
+      take((cache_alignment - this->offset % cache_alignment) % cache_alignment);
+      if (count > (this->size - this->offset) / sizeof(T))
+        throw std::runtime_error("Dataset cache is truncated");
+      return Span<T>(reinterpret_cast<const T*>(take(count * sizeof(T))), count);
+    }
+
+  private:
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+
+    const char* take(size_t count) {
+      if (count > this->size - this->offset)
+        throw std::runtime_error("Dataset cache is truncated");
+      const char* taken = this->data + this->offset;
+      this->offset += count;
+      return taken;
+    }
+  };
+
+  // split a CSV line into fields. Fields are views into the line. Returns false for a blank line
+  // commas are searched 16 bytes at a time where SSE2 is available
+  bool split(std::string_view sv, std::vector<std::string_view>& fields) {
+    fields.clear();
+    if (!sv.empty() && sv.back() == '\r')
+      sv.remove_suffix(1);
+    if (sv.empty())
+      return false;
+
+    const char* data = sv.data();
+    size_t start = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(',');
+    for (; i + 16 <= sv.size(); i += 16) {
+      unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), comma));
+      for (; mask; mask &= mask - 1) {
+        size_t end = i + __builtin_ctz(mask);
+        fields.push_back(sv.substr(start, end - start));
+        start = end + 1;
+      }
+    }
+#endif
+    for (; i < sv.size(); ++i) {
+      if (data[i] == ',') {
+        fields.push_back(sv.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+    fields.push_back(sv.substr(start));
+    return true;
+  }
+
+  // next line of a buffer without the line break. Returns false at the end of the buffer
+  bool nextLine(const char*& position, const char* end, std::string_view& line) {
+    if (position >= end)
+      return false;
+
+    auto newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+    auto line_end = newline ? newline : end;
+    line = std::string_view(position, line_end - position);
+    position = newline ? newline + 1 : end;
+    return true;
+  }
+
+  // a field is continuous only if it is entirely consumed as a float
+  // from_chars handles plain decimal numbers; anything else (leading '+' or whitespace, hex floats, out of range values)
+  // falls back to strtof, so the accepted syntax and the values are the same as before
+  bool parseFloat(std::string_view field, float& value) {
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+    if (result.ec == std::errc() && result.ptr == field.data() + field.size())
+      return true;
+
+    std::string buf(field);
+    char* end = nullptr;
+    value = std::strtof(buf.c_str(), &end);
+    return end != buf.c_str() && end == buf.c_str() + buf.size();
+  }
+
+  // replace first-seen codes with codes into the sorted dictionary, so that code order matches value order
+  template <typename Code>
+  void sortDictionary(std::vector<std::string>& dictionary, std::vector<Code>& codes) {
+    std::vector<Code> order(dictionary.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&dictionary](Code lhs, Code rhs){return dictionary[lhs] < dictionary[rhs];});
+
+    std::vector<Code> remap(dictionary.size());
+    std::vector<std::string> sorted(dictionary.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      remap[order[i]] = i;
+      sorted[i] = std::move(dictionary[order[i]]);
+    }
+
+    for (auto& code: codes)
+      if (code < remap.size())
+        code = remap[code];
+    dictionary = std::move(sorted);
+  }
+
+  // an attribute is continuous if every non-empty value of its column is a number
+  void updateTypes(const std::vector<std::string_view>& fields, std::vector<AttributeType>& types) {
+    float value = 0.0f;
+    for (size_t i = 0; i < std::min(types.size(), fields.size()); ++i)
+      if (types[i] == CONTINUOUS && !fields[i].empty() && !parseFloat(fields[i], value))
+        types[i] = DISCRETE;
+  }
+
+  // bits of a float whose unsigned order is the order of the values. -0 and 0 map to the same bits
+  std::uint32_t orderedBits(float value) {
+    value += 0.0f; // -0 -> 0
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+  }
+
+  // cuts the buffer into about count ranges, each ending after a line break or at the end of the buffer
+  std::vector<std::string_view> splitRanges(const char* begin, const char* end, size_t count) {
+    std::vector<std::string_view> ranges;
+    const char* start = begin;
+
+    for (size_t i = 1; i < count; ++i) {
+      const char* cut = begin + (end - begin) * i / count;
+      if (cut < start)
+        continue;
+      auto newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+      if (!newline)
+        break;
+      ranges.emplace_back(start, newline + 1 - start);
+      start = newline + 1;
+    }
+    ranges.emplace_back(start, end - start);
+
+    return ranges;
+  }
+
+  // -0 and 0 are one value, represented by the one in the lowest row
+  template <typename Values, typename Rows>
+  std::vector<float> distinctValues(const Values& values, const Rows& sorted_rows) {
+    std::vector<float> distinct;
+    for (const auto row: sorted_rows)
+      if (distinct.empty() || distinct.back() != values[row])
+        distinct.push_back(values[row]);
+    return distinct;
+  }
+
+  // the header holds the attribute names followed by the class
+  void readHeader(std::string_view line, std::vector<std::string>& names) {
+    std::vector<std::string_view> fields;
+
+    names.clear();
+    if (!split(line, fields) || fields.size() < 2)
+      throw std::runtime_error("Dataset must have at least one attribute and a class");
+
+    for (size_t i = 0; i + 1 < fields.size(); ++i)
+      names.emplace_back(fields[i]);
+  }
+}
+
+// fills the columns of a dataset row by row, once the attribute types are known
+class DatasetBuilder {
+public:
+  DatasetBuilder(Dataset& dataset, const std::vector<std::string>& names, const std::vector<AttributeType>& types);
+  // a value that is not a number in a continuous column is stored as missing. Returns false if there was one
+  bool addRow(const std::vector<std::string_view>& fields);
+  // appends the rows of datasets built with the same names and types, in order, merging their dictionaries
+  // the parts are emptied. Columns are merged concurrently on the pool if given
+  void append(std::vector<Dataset>& parts, ThreadPool* pool);
+  // the discrete column gets the sorted dictionary, values not in it are stored as missing
+  void fixDictionary(size_t column, const std::vector<std::string>& dictionary);
+  // sorts the dictionaries and, if asked, the rows of the continuous columns
+  void finish(bool sort_rows, ThreadPool* pool=nullptr);
+
+private:
+  Dataset& dataset;
+  std::vector<std::unordered_map<std::string, DiscreteCode>> codes;
+  std::vector<char> fixed; // per column, the dictionary is fixed and already sorted
+  std::unordered_map<std::string, ClassCode> class_codes;
+  std::string key; // reused for lookups, so that known values allocate nothing
+};
+
+DatasetBuilder::DatasetBuilder(Dataset& dataset, const std::vector<std::string>& names, const std::vector<AttributeType>& types)
+  : dataset(dataset)
+  , codes(names.size())
+  , fixed(names.size(), false)
+{
+  dataset = Dataset();
+  for (size_t i = 0; i < names.size(); ++i)
+    dataset.columns.push_back(Dataset::Column{names[i], types[i], {}, {}, {}, {}, {}, {}});
+}
+
+bool DatasetBuilder::addRow(const std::vector<std::string_view>& fields) {
+  size_t attr_count = this->dataset.columns.size();
+  float value = 0.0f;
+  bool fits = true;
+
+  for (size_t i = 0; i < attr_count; ++i) {
+    auto& column = this->dataset.columns[i];
+    bool present = i < fields.size() && !fields[i].empty();
+
+    if (column.type == CONTINUOUS) {
+      if (!present) {
+        value = std::nanf("");
+      } else if (!parseFloat(fields[i], value)) {
+        value = std::nanf("");
+        fits = false;
+      }
+      column.continuous.owned.push_back(value);
+    } else if (!present) {
+      column.discrete.owned.push_back(Dataset::missing_code);
+    } else {
+      this->key.assign(fields[i]);
+      auto it = this->codes[i].find(this->key);
+      if (it == this->codes[i].end()) {
+        if (this->fixed[i]) {
+          column.discrete.owned.push_back(Dataset::missing_code);
+          continue;
+        }
+        it = this->codes[i].emplace(this->key, column.dictionary.size()).first;
+        column.dictionary.push_back(this->key);
+      }
+      column.discrete.owned.push_back(it->second);
+    }
+  }
+
+  if (attr_count < fields.size())
+    this->key.assign(fields[attr_count]);
+  else
+    this->key.clear();
+  auto it = this->class_codes.find(this->key);
+  if (it == this->class_codes.end()) {
+    if (this->dataset.class_names.size() > std::numeric_limits<ClassCode>::max())
+      throw std::runtime_error("Too many classes in the dataset");
+    it = this->class_codes.emplace(this->key, this->dataset.class_names.size()).first;
+    this->dataset.class_names.push_back(this->key);
+  }
+  this->dataset.class_column.owned.push_back(it->second);
+  ++this->dataset.rows;
+
+  return fits;
+}
+
+void DatasetBuilder::append(std::vector<Dataset>& parts, ThreadPool* pool) {
+  size_t attr_count = this->dataset.columns.size();
+
+  // task i < attr_count merges column i, the last task merges the class column
+  auto merge = [&](size_t i) {
+    if (i == attr_count) {
+      for (auto& part: parts) {
+        std::vector<ClassCode> remap(part.class_names.size());
+        for (size_t code = 0; code < remap.size(); ++code) {
+          auto inserted = this->class_codes.emplace(part.class_names[code], this->dataset.class_names.size());
+          if (inserted.second) {
+            if (this->dataset.class_names.size() > std::numeric_limits<ClassCode>::max())
+              throw std::runtime_error("Too many classes in the dataset");
+            this->dataset.class_names.push_back(part.class_names[code]);
+          }
+          remap[code] = inserted.first->second;
+        }
+
+        for (const auto code: part.class_column.owned)
+          this->dataset.class_column.owned.push_back(remap[code]);
+        part.class_column.owned = std::vector<ClassCode>();
+      }
+      return;
+    }
+
+    auto& column = this->dataset.columns[i];
+    for (auto& part: parts) {
+      auto& part_column = part.columns[i];
+
+      if (column.type == CONTINUOUS) {
+        column.continuous.owned.insert(column.continuous.owned.end(), part_column.continuous.owned.begin(), part_column.continuous.owned.end());
+        part_column.continuous.owned = std::vector<float>();
+        continue;
+      }
+
+      // first-seen codes of the part -> first-seen codes of the whole dataset
+      std::vector<DiscreteCode> remap(part_column.dictionary.size());
+      for (size_t code = 0; code < remap.size(); ++code) {
+        auto inserted = this->codes[i].emplace(part_column.dictionary[code], column.dictionary.size());
+        if (inserted.second)
+          column.dictionary.push_back(part_column.dictionary[code]);
+        remap[code] = inserted.first->second;
+      }
+
+      for (const auto code: part_column.discrete.owned)
+        column.discrete.owned.push_back(code == Dataset::missing_code ? code : remap[code]);
+      part_column.discrete.owned = std::vector<DiscreteCode>();
+    }
+  };
+
+  if (pool) {
+    pool->parallelFor(attr_count + 1, merge);
+  } else {
+    for (size_t i = 0; i <= attr_count; ++i)
+      merge(i);
+  }
+
+  for (const auto& part: parts)
+    this->dataset.rows += part.rows;
+}
+
+void DatasetBuilder::fixDictionary(size_t column, const std::vector<std::string>& dictionary) {
+  this->dataset.columns[column].dictionary = dictionary;
+  this->codes[column].clear();
+  for (size_t code = 0; code < dictionary.size(); ++code)
+    this->codes[column].emplace(dictionary[code], code);
+  this->fixed[column] = true;
+}
+
+void DatasetBuilder::finish(bool sort_rows, ThreadPool* pool) {
+  auto sort = [this, sort_rows](size_t i) {
+    auto& column = this->dataset.columns[i];
+    if (column.type == DISCRETE) {
+      if (!this->fixed[i])
+        sortDictionary(column.dictionary, column.discrete.owned);
+      return;
+    }
+    if (!sort_rows)
+      return;
+
+    // sorted row index used by the threshold scan in Rule::grow
+    // rows are sorted as (value, row) keys packed into one integer, which orders equal values by row
+    // like a stable sort would, without the indirect compares
+    const auto& values = column.continuous.owned;
+    std::vector<std::uint64_t> keys;
+    keys.reserve(values.size());
+    for (size_t row = 0; row < values.size(); ++row)
+      if (!std::isnan(values[row]))
+        keys.push_back(std::uint64_t(orderedBits(values[row])) << 32 | row);
+    std::sort(keys.begin(), keys.end());
+
+    column.sorted_rows.owned.reserve(keys.size());
+    for (const auto key: keys)
+      column.sorted_rows.owned.push_back(static_cast<std::uint32_t>(key));
+
+    column.distinct.owned = distinctValues(values, column.sorted_rows.owned);
+  };
+
+  if (pool) {
+    pool->parallelFor(this->dataset.columns.size(), sort);
+  } else {
+    for (size_t i = 0; i < this->dataset.columns.size(); ++i)
+      sort(i);
+  }
+  sortDictionary(this->dataset.class_names, this->dataset.class_column.owned);
+}
+
+Dataset::Dataset(const std::string& path, ThreadPool* pool) {
+  auto file = std::make_shared<const MappedFile>(path);
+  if (file->size() >= sizeof(cache_magic) && std::memcmp(file->data(), cache_magic, sizeof(cache_magic)) == 0) {
+    readCache(file);
+    return;
+  }
+
+  const char* position = file->data();
+  const char* end = position + file->size();
+  std::string_view line;
+  std::vector<std::string_view> fields;
+  std::vector<std::string> names;
+
+  if (!nextLine(position, end, line))
+    return;
+  readHeader(line, names);
+  const char* first_row = position;
+
+  // the attribute types are guessed from a sample of rows
+  std::vector<AttributeType> types(names.size(), CONTINUOUS);
+  for (size_t sampled = 0; sampled < type_sample_rows && nextLine(position, end, line);) {
+    if (split(line, fields)) {
+      updateTypes(fields, types);
+      ++sampled;
+    }
+  }
+
+  // the rows are cut into ranges of whole lines, parsed concurrently into parts and appended in order
+  size_t range_count = 1;
+  if (pool)
+    range_count = std::clamp<size_t>((end - first_row) / min_range_bytes, 1, pool->size() * 4);
+  auto ranges = splitRanges(first_row, end, range_count);
+
+  // if a row of a range shows that the guessed types are wrong, the rest of the range is only checked for types
+  // and all ranges are parsed again with the corrected types, so the result never depends on the sample
+  std::vector<Dataset> parts;
+  while (true) {
+    parts.assign(ranges.size(), Dataset());
+    std::vector<std::vector<AttributeType>> range_types(ranges.size(), types);
+    std::vector<char> fits(ranges.size(), true);
+
+    auto parse = [&](size_t i) {
+      std::string_view range_line;
+      std::vector<std::string_view> range_fields;
+      const char* range_position = ranges[i].data();
+      const char* range_end = range_position + ranges[i].size();
+      DatasetBuilder builder(parts[i], names, types);
+
+      while (nextLine(range_position, range_end, range_line)) {
+        if (!split(range_line, range_fields))
+          continue;
+        if (fits[i]) {
+          fits[i] = builder.addRow(range_fields);
+          if (!fits[i])
+            updateTypes(range_fields, range_types[i]);
+        } else {
+          updateTypes(range_fields, range_types[i]);
+        }
+      }
+    };
+
+    if (pool) {
+      pool->parallelFor(ranges.size(), parse);
+    } else {
+      for (size_t i = 0; i < ranges.size(); ++i)
+        parse(i);
+    }
+
+    if (std::all_of(fits.begin(), fits.end(), [](char range_fits){return range_fits;}))
+      break;
+
+    for (const auto& corrected: range_types)
+      for (size_t i = 0; i < types.size(); ++i)
+        if (corrected[i] == DISCRETE)
+          types[i] = DISCRETE;
+  }
+
+  DatasetBuilder builder(*this, names, types);
+  builder.append(parts, pool);
+  builder.finish(true, pool);
+}
+
+bool Dataset::isCache(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  char magic[sizeof(cache_magic)] = {};
+  return input.read(magic, sizeof(magic)) && std::memcmp(magic, cache_magic, sizeof(magic)) == 0;
+}
+
+void Dataset::write(const std::string& path_to_cache) const {
+  CacheWriter writer(path_to_cache);
+
+  writer.array(Span<char>(cache_magic, sizeof(cache_magic)));
+  writer.value<std::uint32_t>(cache_version);
+  writer.value<std::uint32_t>(byte_order_mark);
+  writer.value<std::uint64_t>(this->rows);
+  writer.value<std::uint64_t>(this->columns.size());
+
+  for (const auto& column: this->columns) {
+    writer.value<std::uint8_t>(column.type);
+    writer.string(column.name);
+    if (column.type == DISCRETE) {
+      writer.value<std::uint64_t>(column.dictionary.size());
+      for (const auto& value: column.dictionary)
+        writer.string(value);
+    }
+  }
+
+  writer.value<std::uint64_t>(this->class_names.size());
+  for (const auto& class_name: this->class_names)
+    writer.string(class_name);
+
+  for (const auto& column: this->columns) {
+    if (column.type == DISCRETE) {
+      writer.array(column.discrete.get());
+      continue;
+    }
+
+    writer.array(column.continuous.get());
+    writer.value<std::uint64_t>(column.sorted_rows.get().size());
+    writer.array(column.sorted_rows.get());
+    writer.value<std::uint64_t>(column.distinct.get().size());
+    writer.array(column.distinct.get());
+  }
+  writer.array(this->class_column.get());
+
+  writer.close();
+}
+
+Dataset Dataset::subset(const RowView& rows) const {
+  Dataset subset;
+  subset.rows = this->rows;
+  subset.class_names = this->class_names;
+  subset.class_column.mapped = this->class_column.get();
+  subset.mapping = this->mapping;
+
+  std::vector<char> included(this->rows, false);
+  for (const auto row: rows)
+    included[row] = true;
+
+  for (const auto& column: this->columns) {
+    subset.columns.push_back(Column{column.name, column.type, {}, {}, column.dictionary, {}, {}, {}});
+    auto& subset_column = subset.columns.back();
+    if (column.type == DISCRETE) {
+      // the codes stay the ones of the whole dictionary, only the values of the given rows are listed
+      auto codes = column.discrete.get();
+      std::vector<char> present(column.dictionary.size(), false);
+      for (const auto row: rows)
+        if (codes[row] != missing_code)
+          present[codes[row]] = true;
+
+      subset_column.discrete.mapped = codes;
+      subset_column.present.emplace();
+      for (size_t code = 0; code < present.size(); ++code)
+        if (present[code])
+          subset_column.present->push_back(column.dictionary[code]);
+      continue;
+    }
+
+    subset_column.continuous.mapped = column.continuous.get();
+    for (const auto row: column.sorted_rows.get())
+      if (included[row])
+        subset_column.sorted_rows.owned.push_back(row);
+    subset_column.distinct.owned = distinctValues(subset_column.continuous.mapped, subset_column.sorted_rows.owned);
+  }
+
+  return subset;
+}
+
+void Dataset::readCache(std::shared_ptr<const MappedFile> file) {
+  CacheReader reader(*file);
+
+  reader.array<char>(sizeof(cache_magic));
+  auto version = reader.value<std::uint32_t>();
+  if (version != cache_version)
+    throw std::runtime_error("Unsupported dataset cache version " + std::to_string(version));
+  if (reader.value<std::uint32_t>() != byte_order_mark)
+    throw std::runtime_error("Dataset cache was written with a different byte order");
+
+  // counts are bounded by the bytes their items take at least: a class code per row, a type and a name length per
+  // attribute, a length per string
+  this->rows = reader.count(sizeof(ClassCode));
+  this->columns.resize(reader.count(sizeof(std::uint8_t) + sizeof(std::uint64_t)));
+  for (auto& column: this->columns) {
+    column.type = static_cast<AttributeType>(reader.value<std::uint8_t>());
+    column.name = reader.string();
+    if (column.type == DISCRETE) {
+      column.dictionary.resize(reader.count(sizeof(std::uint64_t)));
+      for (auto& value: column.dictionary)
+        value = reader.string();
+    } else if (column.type != CONTINUOUS) {
+      throw std::runtime_error("Dataset cache is corrupted");
+    }
+  }
+
+  this->class_names.resize(reader.count(sizeof(std::uint64_t)));
+  for (auto& class_name: this->class_names)
+    class_name = reader.string();
+
+  // codes and row ids index the dictionaries and the columns unchecked, so every one of them is checked once here
+  for (auto& column: this->columns) {
+    if (column.type == DISCRETE) {
+      column.discrete.mapped = reader.array<DiscreteCode>(this->rows);
+      for (const auto code: column.discrete.mapped)
+        if (code >= column.dictionary.size() && code != missing_code)
+          throw std::runtime_error("Dataset cache is corrupted");
+      continue;
+    }
+
+    column.continuous.mapped = reader.array<float>(this->rows);
+    column.sorted_rows.mapped = reader.array<std::uint32_t>(reader.value<std::uint64_t>());
+    for (const auto row: column.sorted_rows.mapped)
+      if (row >= this->rows)
+        throw std::runtime_error("Dataset cache is corrupted");
+    column.distinct.mapped = reader.array<float>(reader.value<std::uint64_t>());
+  }
+  this->class_column.mapped = reader.array<ClassCode>(this->rows);
+  for (const auto code: this->class_column.mapped)
+    if (code >= this->class_names.size())
+      throw std::runtime_error("Dataset cache is corrupted");
+
+  this->mapping = std::move(file);
+}
+
+DatasetReader::DatasetReader(const std::string& path_to_csv, size_t chunk_rows, const Schema& schema)
+  : input(path_to_csv)
+  , chunk_rows(std::max<size_t>(chunk_rows, 1))
+{
+  if (!this->input.is_open())
+    throw std::runtime_error("Failed to open the dataset file " + path_to_csv);
+
+  std::string line;
+  if (std::getline(this->input, line))
+    readHeader(line, this->names);
+
+  std::unordered_map<std::string_view, const Schema::Attribute*> attributes;
+  for (const auto& attribute: schema.attributes)
+    attributes.emplace(attribute.name, &attribute);
+
+  for (const auto& name: this->names) {
+    auto it = attributes.find(name);
+    if (it == attributes.end()) {
+      this->types.push_back(DISCRETE);
+      this->dictionaries.emplace_back(std::vector<std::string>());
+    } else {
+      this->types.push_back(it->second->type);
+      if (it->second->type == DISCRETE)
+        this->dictionaries.emplace_back(it->second->dictionary);
+      else
+        this->dictionaries.emplace_back();
+    }
+  }
+}
+
+bool DatasetReader::next(Dataset& chunk) {
+  if (this->names.empty())
+    return false;
+
+  std::string line;
+  std::vector<std::string_view> fields;
+
+  DatasetBuilder builder(chunk, this->names, this->types);
+  for (size_t i = 0; i < this->dictionaries.size(); ++i)
+    if (this->dictionaries[i])
+      builder.fixDictionary(i, *this->dictionaries[i]);
+
+  while (chunk.size() < this->chunk_rows && std::getline(this->input, line)) {
+    if (split(line, fields))
+      builder.addRow(fields);
+  }
+  builder.finish(false);
+
+  return chunk.size() > 0;
+}
+
+RowParser::RowParser(const Schema& schema, std::string_view header) {
+  std::vector<std::string> names;
+  readHeader(header, names);
+
+  std::unordered_map<std::string_view, const Schema::Attribute*> attributes;
+  for (const auto& attribute: schema.attributes)
+    attributes.emplace(attribute.name, &attribute);
+
+  // columns the schema does not know are discrete with no values, so they are always missing
+  for (const auto& name: names) {
+    auto it = attributes.find(name);
+    if (it == attributes.end())
+      this->layout.columns.push_back(Dataset::Column{name, DISCRETE, {}, {}, {}, {}, {}, {}});
+    else
+      this->layout.columns.push_back(Dataset::Column{name, it->second->type, {}, {}, it->second->dictionary, {}, {}, {}});
+  }
+
+  this->codes.resize(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    const auto& dictionary = this->layout.columns[i].dictionary;
+    for (size_t code = 0; code < dictionary.size(); ++code)
+      this->codes[i].emplace(dictionary[code], code);
+  }
+}
+
+void RowParser::parse(const std::vector<std::string_view>& lines, Dataset& batch) {
+  size_t attr_count = this->layout.columns.size();
+
+  batch = Dataset();
+  batch.rows = lines.size();
+  batch.columns.resize(attr_count);
+  for (size_t i = 0; i < attr_count; ++i) {
+    batch.columns[i].type = this->layout.columns[i].type;
+    if (batch.columns[i].type == CONTINUOUS)
+      batch.columns[i].continuous.owned.reserve(lines.size());
+    else
+      batch.columns[i].discrete.owned.reserve(lines.size());
+  }
+
+  for (const auto& line: lines) {
+    split(line, this->fields);
+    for (size_t i = 0; i < attr_count; ++i) {
+      auto& column = batch.columns[i];
+      bool present = i < this->fields.size() && !this->fields[i].empty();
+
+      if (column.type == CONTINUOUS) {
+        float value = 0.0f;
+        if (!present || !parseFloat(this->fields[i], value))
+          value = std::nanf("");
+        column.continuous.owned.push_back(value);
+      } else {
+        auto it = present ? this->codes[i].find(this->fields[i]) : this->codes[i].end();
+        column.discrete.owned.push_back(it == this->codes[i].end() ? Dataset::missing_code : it->second);
+      }
+    }
+  }
+}
+
+size_t Dataset::getColumn(const std::string& attr_name) const {
+  for (size_t column = 0; column < this->columns.size(); ++column)
+    if (this->columns[column].name == attr_name)
+      return column;
+  throw std::runtime_error("Dataset has no attribute " + attr_name);
+}
+
+DiscreteCode Dataset::encode(size_t column, std::string_view value) const {
+  const auto& dictionary = this->columns[column].dictionary;
+  auto it = std::lower_bound(dictionary.begin(), dictionary.end(), value);
+  if (it == dictionary.end() || *it != value)
+    return missing_code;
+  return it - dictionary.begin();
+}
@@ -0,0 +1,37 @@
+#include "../header/json.h"
+#include <cstdio>
+
+std::string Json::quote(std::string_view text) {
+  std::string result = "\"";
+  result.reserve(text.size() + 2);
+
+  for (const char c: text) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\r':
+        result += "\\r";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+          result += escaped;
+        } else {
+          result += c;
+        }
+    }
+  }
+
+  return result + "\"";
+}
@@ -0,0 +1,51 @@
+#include "../header/mappedfile.h"
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIPPERK_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef RIPPERK_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Failed to open the file " + path);
+
+  struct stat info;
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    this->length = info.st_size;
+    if (this->length == 0) {
+      ::close(fd);
+      return;
+    }
+
+    void* address = ::mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED) {
+      ::madvise(address, this->length, MADV_SEQUENTIAL);
+      this->mapped = static_cast<const char*>(address);
+      ::close(fd);
+      return;
+    }
+  }
+  ::close(fd); // not a regular file or mmap failed, read it instead
+#endif
+
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open())
+    throw std::runtime_error("Failed to open the file " + path);
+
+  this->buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+  this->length = this->buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef RIPPERK_MMAP
+  if (this->mapped)
+    ::munmap(const_cast<char*>(this->mapped), this->length);
+#endif
+}
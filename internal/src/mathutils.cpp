@@ -1,8 +1,21 @@
 #include "../header/mathutils.h"
 #include <limits>
 #include <cmath>
+#include <math.h>
+
+namespace {
+  // lgamma writes the global signgam, which is a data race when classes are trained concurrently
+  double log_gamma(double x) {
+#if defined(__GLIBC__) || defined(__APPLE__)
+    int sign = 0;
+    return lgamma_r(x, &sign);
+#else
+    return std::lgamma(x);
+#endif
+  }
+}
 
 float MathUtils::log2_combination(int n, int k) {
   if (k > n || k < 0) return -std::numeric_limits<float>::infinity();
-  return (lgamma(n + 1) - lgamma(k + 1) - lgamma(n - k + 1)) / std::log(2);
-}
\ No newline at end of file
+  return (log_gamma(n + 1) - log_gamma(k + 1) - log_gamma(n - k + 1)) / std::log(2);
+}
@@ -0,0 +1,72 @@
+#include "../header/mdl.h"
+#include "../header/metrics.h"
+#include <stdexcept>
+#include <iterator>
+
+DLEvaluator::DLEvaluator(const Dataset& dataset, const RowView& pos, const RowView& neg)
+  : dataset(dataset)
+  , residual_pos(dataset.size(), pos)
+  , residual_neg(dataset.size(), neg)
+{}
+
+DLEvaluator::DLEvaluator(const Dataset& dataset, const RowView& pos, const RowView& neg, const Ruleset& ruleset)
+  : DLEvaluator(dataset, pos, neg)
+{
+  for (const auto& handle: ruleset.get())
+    add(ruleset.getRule(handle));
+}
+
+void DLEvaluator::append(Bitset covered, float rule_dl) {
+  METRICS_PHASE(DL);
+  Entry entry{std::move(covered), this->residual_pos, this->residual_neg, rule_dl, this->total};
+
+  this->total += entry.rule_dl + Rule::dl_err(entry.covered, entry.pos, entry.neg);
+  this->residual_pos.andNot(entry.covered);
+  this->residual_neg.andNot(entry.covered);
+  this->entries.push_back(std::move(entry));
+}
+
+float DLEvaluator::add(const Rule& rule) {
+  append(rule.coverage(this->dataset), rule.dl());
+  return this->total;
+}
+
+void DLEvaluator::replace(size_t index, const Rule& rule) {
+  if (index >= this->entries.size())
+    throw std::runtime_error("Rule is not present in the rule set");
+
+  // rewind to the state before the rule and replay the rest with their cached coverage
+  std::vector<Entry> tail(std::make_move_iterator(this->entries.begin() + index + 1), std::make_move_iterator(this->entries.end()));
+  this->residual_pos = std::move(this->entries[index].pos);
+  this->residual_neg = std::move(this->entries[index].neg);
+  this->total = this->entries[index].dl_before;
+  this->entries.resize(index);
+
+  add(rule);
+  for (auto& entry: tail)
+    append(std::move(entry.covered), entry.rule_dl);
+}
+
+float DLEvaluator::dlWith(size_t index, const Rule& rule) const {
+  if (index >= this->entries.size())
+    throw std::runtime_error("Rule is not present in the rule set");
+
+  METRICS_PHASE(DL);
+  Bitset pos = this->entries[index].pos;
+  Bitset neg = this->entries[index].neg;
+  float dl_sum = this->entries[index].dl_before;
+
+  Bitset covered = rule.coverage(this->dataset);
+  dl_sum += rule.dl() + Rule::dl_err(covered, pos, neg);
+  pos.andNot(covered);
+  neg.andNot(covered);
+
+  for (size_t i = index + 1; i < this->entries.size(); ++i) {
+    const auto& entry = this->entries[i];
+    dl_sum += entry.rule_dl + Rule::dl_err(entry.covered, pos, neg);
+    pos.andNot(entry.covered);
+    neg.andNot(entry.covered);
+  }
+
+  return dl_sum;
+}
@@ -0,0 +1,126 @@
+#include "../header/metrics.h"
+#include "../header/json.h"
+
+#ifdef RIPPERK_METRICS
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+  const char* counter_names[Metrics::counter_count] = {"candidates", "cover_calls", "rows_scanned", "rules_added", "rules_rejected"};
+  const char* phase_names[Metrics::phase_count] = {"produce_dataset", "fit", "class", "irep", "optimize", "grow", "prune", "dl"};
+
+  std::mutex records_mutex;
+  std::map<std::string, std::unique_ptr<Metrics::Record>> records; // by class name, "" is the work outside of any class
+
+  thread_local Metrics::Record* current_record = nullptr;
+
+  // values of a record at one point in time, or a sum of them
+  struct Snapshot {
+    std::uint64_t counters[Metrics::counter_count] = {};
+    std::uint64_t phase_calls[Metrics::phase_count] = {};
+    std::uint64_t phase_ns[Metrics::phase_count] = {};
+
+    void add(const Metrics::Record& record) {
+      for (size_t counter = 0; counter < Metrics::counter_count; ++counter)
+        this->counters[counter] += record.counters[counter].load(std::memory_order_relaxed);
+      for (size_t phase = 0; phase < Metrics::phase_count; ++phase) {
+        this->phase_calls[phase] += record.phase_calls[phase].load(std::memory_order_relaxed);
+        this->phase_ns[phase] += record.phase_ns[phase].load(std::memory_order_relaxed);
+      }
+    }
+
+    void write(std::ostream& output, const std::string& indent) const {
+      output << indent << "\"phases\": {";
+      for (size_t phase = 0; phase < Metrics::phase_count; ++phase)
+        output << (phase ? ", " : "") << "\"" << phase_names[phase] << "\": {\"calls\": " << this->phase_calls[phase]
+               << ", \"ms\": " << this->phase_ns[phase] / 1e6 << "}";
+      output << "},\n";
+
+      output << indent << "\"counters\": {";
+      for (size_t counter = 0; counter < Metrics::counter_count; ++counter)
+        output << (counter ? ", " : "") << "\"" << counter_names[counter] << "\": " << this->counters[counter];
+      output << "}\n";
+    }
+  };
+}
+
+Metrics::Record* Metrics::record(const std::string& class_name) {
+  std::lock_guard<std::mutex> lock(records_mutex);
+  auto& record = records[class_name];
+  if (!record)
+    record = std::make_unique<Record>();
+  return record.get();
+}
+
+Metrics::Record* Metrics::current() {
+  static Record* const outside = record("");
+  return current_record ? current_record : outside;
+}
+
+Metrics::Scope::Scope(const std::string& class_name)
+  : Scope(record(class_name))
+{}
+
+Metrics::Scope::Scope(Record* record)
+  : previous(current_record)
+{
+  current_record = record;
+}
+
+Metrics::Scope::~Scope() {
+  current_record = this->previous;
+}
+
+Metrics::PhaseTimer::PhaseTimer(Phase phase)
+  : record(current())
+  , phase(phase)
+  , start(std::chrono::steady_clock::now())
+{}
+
+Metrics::PhaseTimer::~PhaseTimer() {
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+  this->record->phase_calls[this->phase].fetch_add(1, std::memory_order_relaxed);
+  this->record->phase_ns[this->phase].fetch_add(elapsed, std::memory_order_relaxed);
+}
+
+void Metrics::write(const std::string& path) {
+  std::ofstream output(path);
+  if (!output.is_open())
+    throw std::runtime_error("Failed to write the metrics " + path);
+  output << std::fixed << std::setprecision(3);
+
+  Snapshot total;
+  std::map<std::string, Snapshot> classes;
+  {
+    std::lock_guard<std::mutex> lock(records_mutex);
+    for (const auto& [class_name, record]: records) {
+      total.add(*record);
+      if (!class_name.empty())
+        classes[class_name].add(*record);
+    }
+  }
+
+  output << "{\n";
+  output << "  \"total\": {\n";
+  total.write(output, "    ");
+  output << "  },\n";
+  output << "  \"classes\": {";
+  size_t i = 0;
+  for (const auto& [class_name, snapshot]: classes) {
+    output << (i++ ? ",\n" : "\n") << "    " << Json::quote(class_name) << ": {\n";
+    snapshot.write(output, "      ");
+    output << "    }";
+  }
+  output << (classes.empty() ? "}\n" : "\n  }\n");
+  output << "}\n";
+
+  if (!output.good())
+    throw std::runtime_error("Failed to write the metrics " + path);
+}
+
+#endif
@@ -1,6 +1,10 @@
 #include "../header/model.h"
-#include <iostream>
+#include "../header/modelfile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <stdexcept>
 
 Model::Model(std::shared_ptr<const AttributeManager> attribute_manager)
   : attribute_manager(attribute_manager)
@@ -35,90 +39,107 @@ void Model::write(const std::string& path_to_model_txt, const std::string& path_
     model_txt.close();
   }
 
-  // write to a bin file
-  std::ofstream model_bin(path_to_model_bin);
-
-  // bin file structure
-  //
-  // number of classes
-  // class1 name length | class1 name
-  //  number of rules
-  //    number of conditions (rule1)
-  //      |condition1|condition2|...|conditionN|
-  //    number_of_conditions (rulei)
-  //      |condition1|condition2|...|conditionN|
-  // classi name length | classi name
-  //  ...
-  // default class name length | default class name
-
-  if (model_bin.is_open()) {
-    size_t number_of_classes = class_order.size();
-    model_bin.write(reinterpret_cast<const char*>(&number_of_classes), sizeof(number_of_classes));
-
-    for (const auto& class_name: class_order) {
-      size_t class_name_len = class_name.size();
-      const Ruleset& ruleset = this->model.at(class_name);
-      size_t number_of_rules = ruleset.size();
-      auto rules = ruleset.get();
-
-      model_bin.write(reinterpret_cast<const char*>(&class_name_len), sizeof(class_name_len));
-      model_bin.write(class_name.c_str(), class_name_len);
-      model_bin.write(reinterpret_cast<const char*>(&number_of_rules), sizeof(number_of_rules));
-
-      for (const auto& rule_handle: rules)
-        ruleset.getRule(rule_handle).write_bin(model_bin);
+  // write to a bin file, in the layout described in modelfile.h
+  std::vector<ModelFile::Condition> conditions;
+  std::vector<std::uint32_t> rule_ends;
+  std::vector<std::uint32_t> class_ends;
+  std::vector<std::uint32_t> class_names;
+  std::vector<ModelFile::Attribute> attributes;
+  std::vector<std::uint32_t> dictionary;
+  std::vector<ModelFile::StringRef> strings;
+  std::string text;
+
+  std::map<std::string, std::uint32_t> string_indices;
+  auto intern = [&](const std::string& value) {
+    auto [it, inserted] = string_indices.emplace(value, strings.size());
+    if (inserted) {
+      strings.push_back({static_cast<std::uint32_t>(text.size()), static_cast<std::uint32_t>(value.size())});
+      text += value;
     }
-
-    size_t default_class_name_len = this->default_class_name.size();
-    model_bin.write(reinterpret_cast<const char*>(&default_class_name_len), sizeof(default_class_name_len));
-    model_bin.write(this->default_class_name.c_str(), default_class_name_len);
-
-    model_bin.close();
+    return it->second;
+  };
+
+  // the schema, attributes are stored in the order of their ids
+  for (AttributeId id = 0; id < this->attribute_manager->size(); ++id) {
+    ModelFile::Attribute attribute{};
+    attribute.name = intern(this->attribute_manager->getName(id));
+    attribute.type = this->attribute_manager->getAttributeType(id);
+    attribute.dictionary_offset = dictionary.size();
+    for (const auto& value: this->attribute_manager->getDiscreteValues(id))
+      dictionary.push_back(intern(value));
+    attribute.dictionary_size = dictionary.size() - attribute.dictionary_offset;
+    attributes.push_back(attribute);
   }
-}
-
-void Model::read(const std::string& path_to_model_bin) {
-  std::ifstream model_bin(path_to_model_bin, std::ios::binary);
-
-  if (model_bin.is_open()) {
-    size_t number_of_classes = 0;
-    unsigned class_priority = 1;
-    std::string class_name;
-    size_t class_name_len = 0;
-    size_t number_of_rules = 0;
 
-    model_bin.read(reinterpret_cast<char*>(&number_of_classes), sizeof(number_of_classes));
-
-    while (number_of_classes--) { // write all but default
-      Ruleset ruleset;
-      model_bin.read(reinterpret_cast<char*>(&class_name_len), sizeof(class_name_len));
-
-      std::vector<char> buf(class_name_len + 1);
-      model_bin.read(buf.data(), class_name_len);
-      buf.push_back('\0');
-
-      class_name = buf.data();
-      class_order.push_back(class_name);
-
-      model_bin.read(reinterpret_cast<char*>(&number_of_rules), sizeof(number_of_rules));
-      while (number_of_rules--) {
-        Rule rule(this->attribute_manager);
-        rule.read_bin(model_bin);
-        ruleset.addRule(rule);
+  for (const auto& class_name: this->class_order) {
+    const Ruleset& ruleset = this->model.at(class_name);
+    for (const auto& rule_handle: ruleset.get()) {
+      for (const auto& condition: ruleset.getRule(rule_handle).getConditions()) {
+        ModelFile::Condition model_condition{};
+        model_condition.attribute = condition.attr_id;
+        model_condition.cond_operator = condition.cond_operator;
+        if (this->attribute_manager->getAttributeType(condition.attr_id) == CONTINUOUS) {
+          model_condition.threshold = std::get<float>(condition.attr_value);
+        } else {
+          auto values = this->attribute_manager->getDiscreteValues(condition.attr_id);
+          const auto& value = std::get<std::string>(condition.attr_value);
+          auto it = std::lower_bound(values.begin(), values.end(), value);
+          if (it == values.end() || *it != value)
+            throw std::runtime_error("Value " + value + " of a rule is not in the dictionary of its attribute");
+          model_condition.value = it - values.begin();
+        }
+        conditions.push_back(model_condition);
       }
-      this->model[class_name] = std::move(ruleset);
+      rule_ends.push_back(conditions.size());
     }
+    class_ends.push_back(rule_ends.size());
+    class_names.push_back(intern(class_name));
+  }
+  class_names.push_back(intern(this->default_class_name));
+
+  ModelFile::Header header{};
+  std::memcpy(header.magic, ModelFile::magic, sizeof(header.magic));
+  header.version = ModelFile::version;
+  header.byte_order_mark = ModelFile::byte_order_mark;
+
+  std::string model_bin(sizeof(header), '\0');
+  auto append = [&model_bin](ModelFile::Section& section, const auto& elements) {
+    model_bin.resize((model_bin.size() + ModelFile::alignment - 1) / ModelFile::alignment * ModelFile::alignment, '\0');
+    section = {model_bin.size(), elements.size()};
+    model_bin.append(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(elements[0]));
+  };
+  append(header.conditions, conditions);
+  append(header.rule_ends, rule_ends);
+  append(header.class_ends, class_ends);
+  append(header.class_names, class_names);
+  append(header.attributes, attributes);
+  append(header.dictionary, dictionary);
+  append(header.strings, strings);
+  append(header.text, text);
+  std::memcpy(model_bin.data(), &header, sizeof(header));
+
+  // written aside and renamed over the old model, so that a reader mapping the old one is never left with a partial file
+  std::string path_to_written = path_to_model_bin + ".tmp";
+  std::ofstream output(path_to_written, std::ios::binary);
+  if (!output.is_open())
+    throw std::runtime_error("Failed to open the model file " + path_to_written);
+  output.write(model_bin.data(), model_bin.size());
+  output.close();
+  if (output.fail())
+    throw std::runtime_error("Failed to write the model file " + path_to_written);
+  std::filesystem::rename(path_to_written, path_to_model_bin);
+}
 
-    size_t default_class_name_len = 0;
-    model_bin.read(reinterpret_cast<char*>(&default_class_name_len), sizeof(default_class_name_len));
-
-    std::vector<char> buf(default_class_name_len + 1);
-    model_bin.read(buf.data(), default_class_name_len);
-    buf.push_back('\0');
-    this->default_class_name = buf.data();
+Program Model::compile(const Dataset& dataset) const {
+  Program program(dataset);
 
-    model_bin.close();
-  } else {
-    std::cerr << "Failed to open the model file" << std::endl;
+  for (const auto& class_name: this->class_order) {
+    const Ruleset& ruleset = this->model.at(class_name);
+    for (const auto& rule_handle: ruleset.get())
+      ruleset.getRule(rule_handle).compile(dataset, program);
+    program.endClass(class_name);
   }
-}
\ No newline at end of file
+  program.setDefaultClass(this->default_class_name);
+
+  return program;
+}
@@ -0,0 +1,163 @@
+#include "../header/modelfile.h"
+#include "../header/mappedfile.h"
+#include "../header/rule.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+ModelFile::ModelFile(const std::string& path)
+  : file(std::make_shared<const MappedFile>(path))
+{
+  Header header;
+  if (this->file->size() < sizeof(header))
+    throw std::runtime_error("Not a model file: " + path);
+  std::memcpy(&header, this->file->data(), sizeof(header));
+
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error("Not a model file: " + path);
+  if (header.version != version)
+    throw std::runtime_error("Unsupported model file version " + std::to_string(header.version));
+  if (header.byte_order_mark != byte_order_mark)
+    throw std::runtime_error("Model file was written with a different byte order");
+
+  this->conditions = section<Condition>(header.conditions);
+  this->rule_ends = section<std::uint32_t>(header.rule_ends);
+  this->class_ends = section<std::uint32_t>(header.class_ends);
+  this->class_names = section<std::uint32_t>(header.class_names);
+  this->attributes = section<Attribute>(header.attributes);
+  this->dictionary = section<std::uint32_t>(header.dictionary);
+  this->strings = section<StringRef>(header.strings);
+  this->text = section<char>(header.text);
+
+  if (this->class_names.size() != this->class_ends.size() + 1)
+    throw std::runtime_error("Model file is corrupted");
+}
+
+template <typename T>
+Span<T> ModelFile::section(const Section& section) const {
+  if (section.offset % alignment != 0 || section.offset > this->file->size() ||
+      section.count > (this->file->size() - section.offset) / sizeof(T))
+    throw std::runtime_error("Model file is corrupted");
+
+  return Span<T>(reinterpret_cast<const T*>(this->file->data() + section.offset), section.count);
+}
+
+std::string_view ModelFile::string(std::uint32_t index) const {
+  if (index >= this->strings.size())
+    throw std::runtime_error("Model file is corrupted");
+
+  const auto& ref = this->strings[index];
+  if (ref.offset > this->text.size() || ref.length > this->text.size() - ref.offset)
+    throw std::runtime_error("Model file is corrupted");
+
+  return std::string_view(this->text.data() + ref.offset, ref.length);
+}
+
+std::string_view ModelFile::value(const Attribute& attribute, std::uint32_t code) const {
+  if (code >= attribute.dictionary_size || attribute.dictionary_offset > this->dictionary.size() ||
+      attribute.dictionary_size > this->dictionary.size() - attribute.dictionary_offset)
+    throw std::runtime_error("Model file is corrupted");
+
+  return string(this->dictionary[attribute.dictionary_offset + code]);
+}
+
+std::string_view ModelFile::getClassName(size_t index) const {
+  return string(this->class_names[index]);
+}
+
+Schema ModelFile::getSchema() const {
+  Schema schema;
+
+  for (const auto& attribute: this->attributes) {
+    if (attribute.type != CONTINUOUS && attribute.type != DISCRETE)
+      throw std::runtime_error("Model file is corrupted");
+
+    Schema::Attribute schema_attribute{std::string(string(attribute.name)), static_cast<AttributeType>(attribute.type), {}};
+    if (attribute.type == DISCRETE) {
+      schema_attribute.dictionary.reserve(attribute.dictionary_size);
+      for (std::uint32_t code = 0; code < attribute.dictionary_size; ++code)
+        schema_attribute.dictionary.emplace_back(value(attribute, code));
+    }
+    schema.attributes.push_back(std::move(schema_attribute));
+  }
+
+  return schema;
+}
+
+Program ModelFile::compile(const Dataset& dataset) const {
+  return compile(dataset, false);
+}
+
+Program ModelFile::compileForSchema(const Dataset& dataset) const {
+  return compile(dataset, true);
+}
+
+Program ModelFile::compile(const Dataset& dataset, bool schema_codes) const {
+  Program program(dataset);
+
+  std::unordered_map<std::string_view, size_t> columns;
+  for (size_t column = 0; column < dataset.getAttributeCount(); ++column)
+    columns.emplace(dataset.getAttributeName(column), column);
+
+  // only the attributes used by the rules have to be in the dataset
+  constexpr std::uint32_t unresolved = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> attribute_columns(this->attributes.size(), unresolved);
+
+  size_t condition = 0;
+  size_t rule = 0;
+  for (size_t class_index = 0; class_index < this->class_ends.size(); ++class_index) {
+    if (this->class_ends[class_index] > this->rule_ends.size())
+      throw std::runtime_error("Model file is corrupted");
+
+    for (; rule < this->class_ends[class_index]; ++rule) {
+      if (this->rule_ends[rule] > this->conditions.size())
+        throw std::runtime_error("Model file is corrupted");
+
+      for (; condition < this->rule_ends[rule]; ++condition) {
+        const auto& model_condition = this->conditions[condition];
+        if (model_condition.attribute >= attribute_columns.size() || model_condition.cond_operator > MORE_EQ)
+          throw std::runtime_error("Model file is corrupted");
+
+        const auto& attribute = this->attributes[model_condition.attribute];
+        auto& column = attribute_columns[model_condition.attribute];
+        if (column == unresolved) {
+          auto name = string(attribute.name);
+          auto it = columns.find(name);
+          if (it == columns.end())
+            throw std::runtime_error("Dataset has no attribute " + std::string(name));
+          if (dataset.getAttributeType(it->second) != attribute.type)
+            throw std::runtime_error("Attribute " + std::string(name) + " has a different type in the dataset");
+          column = it->second;
+        }
+
+        Program::Op op{};
+        op.column = column;
+        if (attribute.type == CONTINUOUS) {
+          Program::OpCode codes[] = {Program::CONTINUOUS_EQ, Program::CONTINUOUS_LESS_EQ, Program::CONTINUOUS_MORE_EQ};
+          op.code = codes[model_condition.cond_operator];
+          op.threshold = model_condition.threshold;
+        } else {
+          Program::OpCode codes[] = {Program::DISCRETE_EQ, Program::DISCRETE_LESS_EQ, Program::DISCRETE_MORE_EQ};
+          op.code = codes[model_condition.cond_operator];
+          if (schema_codes) {
+            if (model_condition.value >= attribute.dictionary_size)
+              throw std::runtime_error("Model file is corrupted");
+            op.value = model_condition.value;
+          } else {
+            op.value = dataset.encode(op.column, value(attribute, model_condition.value));
+            if (op.value == Dataset::missing_code)
+              op.code = Program::NEVER;
+          }
+        }
+
+        program.addOp(op);
+      }
+      program.endRule();
+    }
+    program.endClass(std::string(getClassName(class_index)));
+  }
+  program.setDefaultClass(std::string(getClassName(this->class_ends.size())));
+
+  return program;
+}
@@ -0,0 +1,91 @@
+#include "../header/program.h"
+#include <algorithm>
+
+Program::Program(const Dataset& dataset) {
+  bind(dataset);
+}
+
+void Program::bind(const Dataset& dataset) {
+  this->continuous.assign(dataset.getAttributeCount(), nullptr);
+  this->discrete.assign(dataset.getAttributeCount(), nullptr);
+  for (size_t column = 0; column < dataset.getAttributeCount(); ++column) {
+    if (dataset.getAttributeType(column) == CONTINUOUS)
+      this->continuous[column] = dataset.getContinuousColumn(column).data();
+    else
+      this->discrete[column] = dataset.getDiscreteColumn(column).data();
+  }
+}
+
+void Program::addOp(Op op) {
+  this->ops.push_back(op);
+}
+
+void Program::endRule() {
+  this->rule_ends.push_back(this->ops.size());
+}
+
+void Program::endClass(const std::string& class_name) {
+  this->class_ends.push_back(this->rule_ends.size());
+  this->class_names.push_back(class_name);
+}
+
+void Program::setDefaultClass(const std::string& class_name) {
+  this->default_class_name = class_name;
+}
+
+void Program::classify(size_t first_row, size_t count, std::uint32_t* classes) const {
+  for (size_t offset = 0; offset < count; offset += block_size)
+    classifyBlock(first_row + offset, std::min(block_size, count - offset), classes + offset);
+}
+
+void Program::classifyBlock(size_t first_row, size_t size, std::uint32_t* classes) const {
+  Bitset unassigned(size, true);
+  size_t op = 0;
+  size_t rule = 0;
+
+  for (size_t class_index = 0; class_index < this->class_ends.size() && unassigned.any(); ++class_index) {
+    Bitset matched(size);
+
+    for (; rule < this->class_ends[class_index]; ++rule) {
+      size_t end = this->rule_ends[rule];
+
+      // rows matched by an earlier rule of the class need no test either
+      Bitset covered = unassigned;
+      covered.andNot(matched);
+      for (; op < end && covered.any(); ++op)
+        covered &= mask(this->ops[op], first_row, size);
+      op = end;
+
+      matched |= covered;
+    }
+
+    matched.forEach([classes, class_index](size_t i){classes[i] = class_index;});
+    unassigned.andNot(matched);
+  }
+
+  std::uint32_t default_class = this->class_ends.size();
+  unassigned.forEach([classes, default_class](size_t i){classes[i] = default_class;});
+}
+
+Bitset Program::mask(const Op& op, size_t first_row, size_t size) const {
+  switch (op.code) {
+    case CONTINUOUS_EQ:
+      return Bitset::equal(this->continuous[op.column] + first_row, size, op.threshold);
+    case CONTINUOUS_LESS_EQ:
+      return Bitset::lessEqual(this->continuous[op.column] + first_row, size, op.threshold);
+    case CONTINUOUS_MORE_EQ:
+      return Bitset::moreEqual(this->continuous[op.column] + first_row, size, op.threshold);
+    case DISCRETE_EQ:
+      return Bitset::equal(this->discrete[op.column] + first_row, size, op.value);
+    case NEVER:
+      return Bitset(size);
+    default: {
+      // ordered comparisons of discrete values are never produced by grow, no vector kernel for them
+      Bitset mask(size);
+      for (size_t i = 0; i < size; ++i)
+        if (test(op, first_row + i))
+          mask.set(i);
+      return mask;
+    }
+  }
+}
@@ -2,63 +2,81 @@
 #include "../header/rule.h"
 #include "../header/mathutils.h"
 #include "../header/model.h"
+#include "../header/modelfile.h"
+#include "../header/server.h"
+#include "../header/mdl.h"
+#include "../header/metrics.h"
+#include "../header/trace.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <numeric>
+#include <stdexcept>
 
 const int bit_len_treshold = 64;
 
-float baseline_dl(const std::list<Instance> dataset, const std::string& default_class) {
-  // assign all instances to teh default class
+float baseline_dl(const Dataset& dataset, const RowView& rows) {
+  // assign all instances to teh default class, the class of the last row
   // use the DL_err formula. No positive or false positive entries will be covered, so the formula is simplified.
-  unsigned n = dataset.size();
+  const auto& classes = dataset.getClassColumn();
+  ClassCode default_class = classes[rows[rows.size() - 1]];
+  unsigned n = rows.size();
   unsigned fn = 0;
 
-  std::for_each(dataset.begin(), dataset.end(), [&fn, &default_class](const auto& instance){fn += (instance.class_value != default_class);});
+  std::for_each(rows.begin(), rows.end(), [&fn, &classes, default_class](const auto row){fn += (classes[row] != default_class);});
 
   // return std::log2((float)factorial(n) / ((float)factorial(fn) * (float)factorial(n-fn)));
   auto result = MathUtils::log2_combination(n, fn);
   return result;
 }
 
-Ruleset RIPPERk::IREP(std::list<Instance> pos, std::list<Instance> neg) { // pass by ref
+// split rows into the grow and prune sets
+// the first split_index + 1 rows go to the grow set. Both are views of rows, no row ids are copied
+static void split(const RowView& rows, float pruning_ratio, RowView& grow, RowView& prune) {
+  size_t split_index = std::min<size_t>(std::floor(rows.size() * pruning_ratio) + 1, rows.size());
+  grow = rows.subview(0, split_index);
+  prune = rows.subview(split_index, rows.size() - split_index);
+}
+
+Ruleset RIPPERk::IREP(const TrainingData& data, RowView pos, RowView neg) {
+  METRICS_PHASE(IREP);
   auto ruleset = Ruleset();
-  // copy pos and neg - needed to calculate the DL
-  auto pos_copy = pos;
-  auto neg_copy = neg;
-  float min_dl = std::max(baseline_dl(this->dataset, this->dataset.rbegin()->class_value), 0.0f);
+  // the DL is calculated on the initial pos and neg, and updated with every added rule
+  DLEvaluator evaluator(data.dataset, pos, neg);
+  float min_dl = std::max(data.baseline_dl, 0.0f);
+  RowView grow_pos, prune_pos, grow_neg, prune_neg;
 
   while (!pos.empty()) {
-    auto rule = Rule(this->attr_manager);
-    unsigned split_index_pos = std::floor(pos.size() * this->pruning_ratio);
-    unsigned split_index_neg = std::floor(neg.size() * this->pruning_ratio);
-    std::list<Instance> grow_pos(pos.begin(), std::next(pos.begin(), split_index_pos + 1));
-    std::list<Instance> prune_pos(std::next(pos.begin(), split_index_pos + 1), pos.end());
-    std::list<Instance> grow_neg(neg.begin(), std::next(neg.begin(), split_index_neg + 1));
-    std::list<Instance> prune_neg(std::next(neg.begin(), split_index_neg + 1), neg.end());
+    TRACE_SCOPE("irep", "rule " + std::to_string(ruleset.size() + 1));
+    auto rule = Rule(data.attr_manager);
+    split(pos, data.pruning_ratio, grow_pos, prune_pos);
+    split(neg, data.pruning_ratio, grow_neg, prune_neg);
 
-    rule.grow(grow_pos, grow_neg);
-    rule.prune(prune_pos, prune_neg);
+    rule.grow(data.dataset, grow_pos, grow_neg, this->pool.get());
+    rule.prune(data.dataset, prune_pos, prune_neg);
 
     // stop adding rules if the grown and pruned rule is empty
     // otherwise, since empry rule has to be discarded (it adds no value), there will be an empty loop,
     // because no instances will be covered and removed and the DL of the ruleset will not increase
-    if (rule.empty())
+    if (rule.empty()) {
+      METRICS_COUNT(RULES_REJECTED, 1);
       return ruleset;
+    }
 
     ruleset.addRule(rule);
+    METRICS_COUNT(RULES_ADDED, 1);
 
-    pos.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
-    neg.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
+    pos = rule.uncovered(data.dataset, pos);
+    neg = rule.uncovered(data.dataset, neg);
 
     // simplify the ruleset
 
     // check MDL of the ruleset
-    // pass copied pos and neg sets to dl in order to calculate the error dl
-    auto dl = ruleset.dl(pos_copy, neg_copy);
+    auto dl = evaluator.add(rule);
     if (dl > min_dl + bit_len_treshold) {
       return ruleset;
     }
@@ -69,13 +87,11 @@ Ruleset RIPPERk::IREP(std::list<Instance> pos, std::list<Instance> neg) { // pas
   return ruleset;
 }
 
-void RIPPERk::optimize(Ruleset& ruleset, std::list<Instance> pos, std::list<Instance> neg) {
-  unsigned split_index_pos = std::floor(pos.size() * this->pruning_ratio);
-  unsigned split_index_neg = std::floor(neg.size() * this->pruning_ratio);
-  std::list<Instance> grow_pos(pos.begin(), std::next(pos.begin(), split_index_pos + 1));
-  std::list<Instance> prune_pos(std::next(pos.begin(), split_index_pos + 1), pos.end());
-  std::list<Instance> grow_neg(neg.begin(), std::next(neg.begin(), split_index_neg + 1));
-  std::list<Instance> prune_neg(std::next(neg.begin(), split_index_neg + 1), neg.end());
+void RIPPERk::optimize(const TrainingData& data, Ruleset& ruleset, const RowView& pos, const RowView& neg) {
+  METRICS_PHASE(OPTIMIZE);
+  RowView grow_pos, prune_pos, grow_neg, prune_neg;
+  split(pos, data.pruning_ratio, grow_pos, prune_pos);
+  split(neg, data.pruning_ratio, grow_neg, prune_neg);
   // iterate through each rule (in order)
   //   construct a replacement rule - grown from scratch
   //     the replacement rule has to be pruned too, "pruning is guided so as to minimize error of the entire rule set R Ri Rk on the pruning data". whatever that means...
@@ -83,190 +99,206 @@ void RIPPERk::optimize(Ruleset& ruleset, std::list<Instance> pos, std::list<Inst
   //   save the current rule too
   //   calculate the DL of the three versions of the ruleset: with the original rule, with the replacement rule and with the revision rule
   //   keep the one rule that gives the smallest DL when inserted in the ruleset
+  //   the replacement and the revision are built concurrently, the replacement in its own copy of the ruleset
+  DLEvaluator evaluator(data.dataset, pos, neg, ruleset);
   auto rule_handles = ruleset.get();
   for (const auto& rule_handle: rule_handles) {
-    Rule original(ruleset.getRule(rule_handle));
-    Rule replacement(original);
+    TRACE_SCOPE("optimize", "revise rule " + std::to_string(rule_handle.id + 1));
+    const Rule& original = ruleset.getRule(rule_handle);
+    Ruleset with_replacement(ruleset);
     Rule revision(original);
-    Rule* final_rule = &original;
-
-    // calculate the DL with the original rule
-    float min_dl = ruleset.dl(pos, neg);
-
-    // grow a replacement rule
-    replacement.removeAllConditions();
-    replacement.grow(grow_pos, grow_neg);
-
-    // replace the original rule with the replacement rule
-    ruleset.replaceRule(rule_handle, replacement);
-
-    // prune the rule with the relation to the whole ruleset
-    ruleset.pruneRule(rule_handle, prune_pos, prune_neg);
+    float dl[3] = {evaluator.dl(), 0.0f, 0.0f}; // original, replacement, revision
+
+    this->pool->parallelFor(2, [&](size_t i) {
+      if (i == 0) {
+        // grow a replacement rule
+        Rule replacement(original);
+        replacement.removeAllConditions();
+        replacement.grow(data.dataset, grow_pos, grow_neg, this->pool.get());
+
+        // replace the original rule with the replacement rule
+        // and prune the rule with the relation to the whole ruleset
+        with_replacement.replaceRule(rule_handle, replacement);
+        with_replacement.pruneRule(rule_handle, data.dataset, prune_pos, prune_neg);
+
+        dl[1] = evaluator.dlWith(rule_handle.id, with_replacement.getRule(rule_handle));
+      } else {
+        // grow and prune a revision rule
+        revision.grow(data.dataset, grow_pos, grow_neg, this->pool.get());
+        revision.prune(data.dataset, prune_pos, prune_neg);
+
+        dl[2] = evaluator.dlWith(rule_handle.id, revision);
+      }
+    });
 
-    // calculate the DL
-    float replacement_dl = ruleset.dl(pos, neg);
-    if (replacement_dl < min_dl) {
-      min_dl = replacement_dl;
-      final_rule = &replacement;
+    // keep the rule with the smallest DL out of three in the ruleset permanently
+    // on a tie the original is preferred to the replacement, and the replacement to the revision
+    float min_dl = dl[0];
+    const Rule* final_rule = &original;
+    if (dl[1] < min_dl) {
+      min_dl = dl[1];
+      final_rule = &with_replacement.getRule(rule_handle);
     }
-
-    // grow and prune a revision rule
-    revision.grow(grow_pos, grow_neg);
-    revision.prune(prune_pos, prune_neg);
-
-    // replace the rule with the revision rule
-    ruleset.replaceRule(rule_handle, revision);
-
-    //calculate the DL
-    float revision_dl = ruleset.dl(pos, neg);
-    if (revision_dl < min_dl) {
+    if (dl[2] < min_dl)
       final_rule = &revision;
-    }
 
-    // keep the rule with the smallest DL out of three in the ruleset permanently
-    ruleset.replaceRule(rule_handle, *final_rule);
+    // the replacement and the revision that are not kept are rejected
+    if (final_rule != &original) {
+      ruleset.replaceRule(rule_handle, *final_rule);
+      evaluator.replace(rule_handle.id, *final_rule);
+      METRICS_COUNT(RULES_ADDED, 1);
+      METRICS_COUNT(RULES_REJECTED, 1);
+    } else {
+      METRICS_COUNT(RULES_REJECTED, 2);
+    }
   }
 }
 
+// the dataset is loaded on first use, the streaming classify never loads it as a whole
 void RIPPERk::produceDataset() { // create class named Utils that takes a RIPPERk object, move this function there
-  std::ifstream input(this->path_to_dataset);
-  std::vector<std::string> keys;
-
-  for (std::string line; std::getline(input, line);) {
-    std::istringstream ss(std::move(line));
-
-    if (keys.empty()) {
-      for (std::string value; std::getline(ss, value, ',');)
-        keys.emplace_back(std::move(value));
-    } else {
-      auto i = keys.begin();
-      Instance instance{};
-
-      for (std::string value; std::getline(ss, value, ',');) {
-        Attribute attribute{};
-        size_t pos = 0;
-        attribute.name = *i;
-        if (value.empty()) {
-          i = std::next(i);
-          continue;
-        }
-        try {
-          attribute.value = std::stof(value, &pos);
-          attribute.type = CONTINUOUS;
-        } catch (const std::invalid_argument&) {
-          // ????
-        }
+  if (this->attr_manager)
+    return;
 
-        if (pos != value.size()) {
-          attribute.value = value;
-          attribute.type = DISCRETE;
-        }
-
-        instance.attributes.emplace_back(attribute);
-        i = std::next(i);
-      }
-
-      try {
-        instance.class_value = std::get<std::string>(instance.attributes.back().value);
-      } catch (const std::exception&){
-        instance.class_value = std::get<float>(instance.attributes.back().value);
-      }
-      instance.attributes.pop_back(); // remove the class from the list of attributes
-      this->dataset.push_back(instance);
-    }
-  }
+  METRICS_PHASE(PRODUCE_DATASET);
+  TRACE_SCOPE("dataset", "produce dataset");
+  this->dataset = Dataset(this->path_to_dataset, this->pool.get());
+  this->attr_manager = std::make_shared<const AttributeManager>(this->dataset);
 }
 
-RIPPERk::RIPPERk(const std::string &path_to_dataset, const std::string &path_to_model_txt, const std::string &path_to_model_bin, float pruning_ratio, int k)
+RIPPERk::RIPPERk(const std::string &path_to_dataset, const std::string &path_to_model_txt, const std::string &path_to_model_bin, float pruning_ratio, int k, unsigned threads)
   : path_to_dataset(path_to_dataset)
   , path_to_model_txt(path_to_model_txt)
   , path_to_model_bin(path_to_model_bin)
   , pruning_ratio(pruning_ratio)
   , k(k)
+  , pool(std::make_unique<ThreadPool>(threads))
   , attr_manager(nullptr)
+{}
+
+void RIPPERk::fit()
 {
+  METRICS_PHASE(FIT);
+  TRACE_SCOPE("fit", "fit");
   produceDataset();
-  this->attr_manager = std::make_shared<const AttributeManager>(this->dataset);
+
+  RowIds all_rows(this->dataset.size());
+  std::iota(all_rows.begin(), all_rows.end(), 0);
+  const RowView rows(std::move(all_rows));
+  if (rows.empty())
+    return;
+
+  TrainingData data{this->dataset, this->attr_manager, rows, this->pruning_ratio, baseline_dl(this->dataset, rows), false};
+  train(data, {this->k})[0].model.write(this->path_to_model_txt, this->path_to_model_bin);
 }
 
-void RIPPERk::fit()
+std::vector<RIPPERk::TrainedModel> RIPPERk::train(const TrainingData& data, const std::vector<int>& ks)
 {
-  Model model(this->attr_manager);
-  std::map<std::string, unsigned> class_count;
-  std::map<std::string, unsigned> class_order;
-  unsigned order = 1;
-  auto max_prevalence = class_count.end();
-
-  for (const auto& instance: this->dataset)
-    class_count[instance.class_value]++;
-
-  while (!class_count.empty()) {
-    max_prevalence = std::max_element(class_count.begin(), class_count.end(),[](const auto& kv1, const auto& kv2){return kv1.second < kv2.second;});
-    class_order[max_prevalence->first] = order++;
-    class_count.erase(max_prevalence);
-  }
-  std::string default_class_name = std::max_element(class_order.begin(), class_order.end(),[](const auto& kv1, const auto& kv2){return kv1.second < kv2.second;})->first;
-  model.setDefaultClass(default_class_name);
+  const auto& class_names = data.dataset.getClassNames();
+  const auto& classes = data.dataset.getClassColumn();
+  std::vector<unsigned> class_count(class_names.size(), 0);
+  std::vector<ClassCode> class_order(class_names.size()); // from the most prevalent to the least prevalent class
+  std::vector<TrainedModel> models(ks.size(), TrainedModel{Model(data.attr_manager), 0.0f});
+
+  for (const auto row: data.rows)
+    class_count[classes[row]]++;
+
+  // ties are resolved in favour of the class with the lower code, i.e. alphabetically
+  // classes without rows come last, so they never become the default class
+  std::iota(class_order.begin(), class_order.end(), 0);
+  std::stable_sort(class_order.begin(), class_order.end(), [&class_count](ClassCode lhs, ClassCode rhs){return class_count[lhs] > class_count[rhs];});
+  while (!class_order.empty() && class_count[class_order.back()] == 0)
+    class_order.pop_back();
+  if (class_order.empty())
+    return models;
+  for (auto& trained: models)
+    trained.model.setDefaultClass(class_names[class_order.back()]);
 
   // iterate from the most prevalent to the least prevalent class
   //   pos = all isntances classified as the current class
   //   neg = all instances classified as classes after the current class
-  auto order_copy = class_order;
-  while (!class_order.empty()) {
-    std::list<Instance> pos;
-    std::list<Instance> neg;
-    auto max_class_it = std::min_element(class_order.begin(), class_order.end(), [](const auto& kv1, const auto& kv2){return kv1.second < kv2.second;});
-    // max_class_it should never be 0
-    std::string pos_class = max_class_it->first;
-
-    // last class is the default class
-    if (class_order.size() > 1) {
-      for (const auto& instance: this->dataset) {
-        if (instance.class_value == pos_class)
-          pos.push_back(instance);
-        else if (class_order.find(instance.class_value) != class_order.end())
-          neg.push_back(instance);
-      }
-
-      model.add(pos_class, std::move(IREP(pos, neg)));
+  // last class is the default class
+  // every class only depends on the order, so the classes are trained concurrently and added to the model in order
+  std::vector<size_t> rank(class_names.size(), class_order.size());
+  for (size_t i = 0; i < class_order.size(); ++i)
+    rank[class_order[i]] = i;
+
+  int max_k = ks.empty() ? 0 : *std::max_element(ks.begin(), ks.end());
+  std::vector<std::vector<Ruleset>> rulesets(class_order.size() - 1, std::vector<Ruleset>(ks.size())); // per class and k
+  std::vector<std::vector<float>> dls(rulesets.size(), std::vector<float>(ks.size(), 0.0f));
+  this->pool->parallelFor(rulesets.size(), [&](size_t i) {
+    METRICS_CLASS(class_names[class_order[i]]);
+    METRICS_PHASE(CLASS);
+    TRACE_SCOPE("class", "class " + class_names[class_order[i]]);
+    RowIds pos_rows;
+    RowIds neg_rows;
+
+    for (const auto row: data.rows) {
+      if (rank[classes[row]] == i)
+        pos_rows.push_back(row);
+      else if (rank[classes[row]] > i)
+        neg_rows.push_back(row);
+    }
 
-      // optimize k times
-      int k = this->k;
-      while (k--)
-        optimize(model.get(pos_class), pos, neg);
+    const RowView pos(std::move(pos_rows));
+    const RowView neg(std::move(neg_rows));
+    Ruleset ruleset = IREP(data, pos, neg);
+
+    // optimize up to the largest k, the ruleset after j optimizations is the one trained with k = j
+    for (int k = 0; k <= max_k; ++k) {
+      for (size_t j = 0; j < ks.size(); ++j) {
+        if (ks[j] == k) {
+          rulesets[i][j] = ruleset;
+          if (data.with_dl)
+            dls[i][j] = ruleset.dl(data.dataset, pos, neg);
+        }
+      }
+      if (k < max_k) {
+        TRACE_SCOPE("optimize", "optimize " + std::to_string(k + 1));
+        optimize(data, ruleset, pos, neg);
+      }
     }
+  });
 
-    class_order.erase(max_class_it);
+  for (size_t j = 0; j < ks.size(); ++j) {
+    for (size_t i = 0; i < rulesets.size(); ++i) {
+      models[j].model.add(class_names[class_order[i]], std::move(rulesets[i][j]));
+      models[j].dl += dls[i][j];
+    }
   }
 
-  model.write(this->path_to_model_txt, this->path_to_model_bin);
+  return models;
+}
+
+// class of the program -> class code in the dataset, classes absent from the dataset never match
+static std::vector<size_t> datasetClasses(const Program& program, const std::vector<std::string>& class_names) {
+  std::vector<size_t> program_classes(program.getClassCount());
+  for (size_t i = 0; i < program_classes.size(); ++i) {
+    auto it = std::lower_bound(class_names.begin(), class_names.end(), program.getClassName(i));
+    program_classes[i] = (it != class_names.end() && *it == program.getClassName(i)) ? it - class_names.begin() : class_names.size();
+  }
+  return program_classes;
 }
 
 void RIPPERk::evaluate()
 {
-  Model model(this->attr_manager);
-  std::string derived_class;
+  produceDataset();
+  ModelFile model(this->path_to_model_bin);
   unsigned match = 0;
   unsigned mismatch = 0;
 
-  model.read(this->path_to_model_bin);
+  auto program = model.compile(this->dataset);
 
   // apply the model to the dataset
   // compare the derived class to the one present in the instance
-  for (const auto& instance: this->dataset) {
-    derived_class.clear();
+  const auto& class_names = this->dataset.getClassNames();
+  const auto& classes = this->dataset.getClassColumn();
 
-    for (const auto& class_name: model.getClassOrder()) {
-      if (model.get(class_name).cover(instance)) {
-        derived_class = class_name;
-        break;
-      }
-    }
-    if (derived_class.empty()) {
-      derived_class = model.getDefaultClass();
-    }
+  auto program_classes = datasetClasses(program, class_names);
 
-    if (derived_class == instance.class_value)
+  std::vector<std::uint32_t> derived_classes(this->dataset.size());
+  program.classify(0, this->dataset.size(), derived_classes.data());
+  for (size_t row = 0; row < this->dataset.size(); ++row) {
+    if (program_classes[derived_classes[row]] == classes[row])
       ++match;
     else
       ++mismatch;
@@ -279,25 +311,210 @@ void RIPPERk::evaluate()
 }
 
 
+static void printClasses(const Program& program, size_t first_row, const std::vector<std::uint32_t>& classes) {
+  for (size_t row = 0; row < classes.size(); ++row)
+    std::cout << "Instance " << first_row + row << " assigned to class " << program.getClassName(classes[row]) << '\n';
+  std::cout.flush();
+}
+
 void RIPPERk::classify() {
-  Model model(this->attr_manager);
-  std::string derived_class;
-  size_t i = 0;
-
-  model.read(this->path_to_model_bin);
-
-  for (const auto& instance: this->dataset) {
-    derived_class.clear();
-    for (const auto& class_name: model.getClassOrder()) {
-      if (model.get(class_name).cover(instance)) {
-        derived_class = class_name;
-        break;
-      }
-    }
-    if (derived_class.empty()) {
-      derived_class = model.getDefaultClass();
+  if (Dataset::isCache(this->path_to_dataset)) {
+    // a cache is mapped rather than read, so it is classified in place a chunk at a time
+    produceDataset();
+    auto program = ModelFile(this->path_to_model_bin).compile(this->dataset);
+
+    std::vector<std::uint32_t> classes;
+    for (size_t first_row = 0; first_row < this->dataset.size(); first_row += stream_chunk_rows) {
+      classes.resize(std::min(stream_chunk_rows, this->dataset.size() - first_row));
+      program.classify(first_row, classes.size(), classes.data());
+      printClasses(program, first_row, classes);
     }
+    return;
+  }
+
+  // the dataset is read against the schema of the model, then classified and printed a chunk at a time
+  // chunks read against a schema all have its columns and dictionaries, so the model is compiled against the first
+  // chunk only and bound to the others
+  ModelFile model(this->path_to_model_bin);
+  DatasetReader reader(this->path_to_dataset, stream_chunk_rows, model.getSchema());
+  Dataset chunk;
+  Program program;
+
+  size_t first_row = 0;
+  std::vector<std::uint32_t> classes;
+  while (reader.next(chunk)) {
+    if (first_row == 0)
+      program = model.compileForSchema(chunk);
+    else
+      program.bind(chunk);
+    classes.resize(chunk.size());
+    program.classify(0, chunk.size(), classes.data());
+    printClasses(program, first_row, classes);
+
+    first_row += chunk.size();
+  }
+}
+
+void RIPPERk::convert(const std::string& path_to_cache) {
+  produceDataset();
+  this->dataset.write(path_to_cache);
+}
 
-    std::cout << "Instance " << i++ << " assigned to class " << derived_class << std::endl;
+void RIPPERk::serve(const std::string& path_to_socket) {
+  Server server(this->path_to_model_bin);
+  if (path_to_socket.empty())
+    server.serve(0, 1);
+  else
+    server.listen(path_to_socket);
+}
+
+void RIPPERk::crossval(size_t folds) {
+  if (folds < 2)
+    throw std::invalid_argument("Cross-validation needs at least 2 folds");
+
+  produceDataset();
+  if (folds > this->dataset.size())
+    throw std::invalid_argument("Cross-validation needs at least one entry per fold");
+  const auto& class_names = this->dataset.getClassNames();
+  const auto& classes = this->dataset.getClassColumn();
+
+  // rows grouped by class are dealt to the folds in turn, so that the folds keep the class distribution and their
+  // sizes differ by at most one
+  std::vector<size_t> fold_of(this->dataset.size());
+  std::vector<size_t> position(class_names.size() + 1, 0); // in the grouped order, of the next row of every class
+  for (size_t row = 0; row < fold_of.size(); ++row)
+    ++position[classes[row] + 1];
+  std::partial_sum(position.begin(), position.end(), position.begin());
+  for (size_t row = 0; row < fold_of.size(); ++row)
+    fold_of[row] = position[classes[row]]++ % folds;
+
+  // every fold trains on a subset sharing the columns and dictionaries of the dataset, with its own sorted rows,
+  // present values and attributes, so values that occur in held-out rows only are unknown to its model
+  std::vector<size_t> trained(folds, 0);
+  std::vector<size_t> tested(folds, 0);
+  std::vector<size_t> matched(folds, 0);
+  this->pool->parallelFor(folds, [&](size_t fold) {
+    TRACE_SCOPE("fold", "fold " + std::to_string(fold + 1));
+    RowIds train_rows;
+    RowIds test_rows;
+    for (size_t row = 0; row < fold_of.size(); ++row)
+      (fold_of[row] == fold ? test_rows : train_rows).push_back(row);
+
+    const RowView rows(std::move(train_rows));
+    trained[fold] = rows.size();
+    tested[fold] = test_rows.size();
+    if (rows.empty())
+      return;
+
+    auto fold_dataset = this->dataset.subset(rows);
+    auto fold_attr_manager = std::make_shared<const AttributeManager>(fold_dataset);
+    TrainingData data{fold_dataset, fold_attr_manager, rows, this->pruning_ratio, baseline_dl(fold_dataset, rows), false};
+    auto program = train(data, {this->k})[0].model.compile(this->dataset);
+    auto program_classes = datasetClasses(program, class_names);
+    for (const auto row: test_rows)
+      matched[fold] += program_classes[program.classify(row)] == classes[row];
+  });
+
+  size_t match = 0;
+  for (size_t fold = 0; fold < folds; ++fold) {
+    std::cout << "Fold " << fold + 1 << ": trained on " << trained[fold] << " entries, analyzed " << tested[fold] << " entries";
+    if (tested[fold])
+      std::cout << ", success rate: " << ((float)matched[fold] / (float)tested[fold]) * 100 << "%";
+    std::cout << std::endl;
+    match += matched[fold];
   }
+
+  std::cout << "Analyzed " << this->dataset.size() << " entries in " << folds << " folds" << std::endl;
+  std::cout << "Correctly predicted classes: " << match << std::endl;
+  std::cout << "Incorrectly predicted classes: " << this->dataset.size() - match << std::endl;
+  std::cout << "Success rate: " << ((float)match / (float)this->dataset.size()) * 100 << "%" << std::endl;
+}
+
+void RIPPERk::sweep(const std::vector<float>& pruning_ratios, const std::vector<int>& ks, const std::string& path_to_test_dataset) {
+  if (pruning_ratios.empty() || ks.empty())
+    throw std::invalid_argument("Sweep needs at least one pruning ratio and one k");
+  if (*std::min_element(ks.begin(), ks.end()) < 0)
+    throw std::invalid_argument("k must not be negative");
+
+  produceDataset();
+  RowIds all_rows(this->dataset.size());
+  std::iota(all_rows.begin(), all_rows.end(), 0);
+  const RowView rows(std::move(all_rows));
+  if (rows.empty())
+    return;
+
+  Dataset test_dataset;
+  if (!path_to_test_dataset.empty())
+    test_dataset = Dataset(path_to_test_dataset, this->pool.get());
+  const Dataset& scored = path_to_test_dataset.empty() ? this->dataset : test_dataset;
+  const auto& scored_classes = scored.getClassColumn();
+
+  struct Result {
+    float pruning_ratio;
+    int k;
+    size_t rules;
+    size_t conditions;
+    float dl;
+    size_t match;
+  };
+
+  // every ratio is one training run on the pool, producing the models of all ks
+  // the dataset, its attributes and the sorted rows are shared by all of them
+  std::vector<Result> results(pruning_ratios.size() * ks.size());
+  float baseline = baseline_dl(this->dataset, rows);
+  this->pool->parallelFor(pruning_ratios.size(), [&](size_t r) {
+    TRACE_SCOPE("sweep", "ratio " + std::to_string(pruning_ratios[r]));
+    TrainingData data{this->dataset, this->attr_manager, rows, pruning_ratios[r], baseline, true};
+    auto trained = train(data, ks);
+
+    for (size_t j = 0; j < ks.size(); ++j) {
+      auto& result = results[r * ks.size() + j];
+      result = Result{pruning_ratios[r], ks[j], 0, 0, trained[j].dl, 0};
+
+      auto& model = trained[j].model;
+      for (const auto& class_name: model.getClassOrder()) {
+        const auto& ruleset = model.get(class_name);
+        result.rules += ruleset.size();
+        for (const auto& rule_handle: ruleset.get())
+          result.conditions += ruleset.getRule(rule_handle).size();
+      }
+
+      auto program = model.compile(scored);
+      auto program_classes = datasetClasses(program, scored.getClassNames());
+      std::vector<std::uint32_t> classes(scored.size());
+      program.classify(0, scored.size(), classes.data());
+      for (size_t row = 0; row < scored.size(); ++row)
+        result.match += program_classes[classes[row]] == scored_classes[row];
+    }
+  });
+
+  std::stable_sort(results.begin(), results.end(), [](const Result& lhs, const Result& rhs) {
+    return lhs.match != rhs.match ? lhs.match > rhs.match : lhs.dl < rhs.dl;
+  });
+
+  std::cout << "Trained " << results.size() << " models on " << this->dataset.size() << " entries, analyzed "
+            << scored.size() << " entries of the " << (path_to_test_dataset.empty() ? "training" : "test") << " dataset" << std::endl;
+  std::cout << std::left << std::setw(6) << "Rank" << std::setw(12) << "Ratio" << std::setw(6) << "k" << std::setw(8) << "Rules"
+            << std::setw(12) << "Conditions" << std::setw(14) << "DL" << "Success rate" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    std::cout << std::setw(6) << i + 1 << std::setw(12) << result.pruning_ratio << std::setw(6) << result.k << std::setw(8) << result.rules
+              << std::setw(12) << result.conditions << std::setw(14) << result.dl
+              << ((float)result.match / (float)scored.size()) * 100 << "%" << std::endl;
+  }
+}
+
+std::vector<std::string> RIPPERk::predict() {
+  produceDataset();
+  auto program = ModelFile(this->path_to_model_bin).compile(this->dataset);
+
+  std::vector<std::uint32_t> classes(this->dataset.size());
+  program.classify(0, this->dataset.size(), classes.data());
+
+  std::vector<std::string> class_names;
+  class_names.reserve(classes.size());
+  for (const auto class_index: classes)
+    class_names.push_back(program.getClassName(class_index));
+
+  return class_names;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "../header/rule.h"
 #include "../header/mathutils.h"
+#include "../header/metrics.h"
+#include "../header/trace.h"
 #include <limits>
 #include <cmath>
 #include <algorithm>
@@ -30,16 +32,9 @@ Rule& Rule::operator=(const Rule& rhs) {
   return *this;
 }
 
-float Rule::foil_gain(const Condition &condition, const std::list<Instance> &pos, const std::list<Instance> &neg) const
+// p and n are covered by the rule, p_new and n_new are covered by the condition
+float Rule::foil_gain(float p, float n, float p_new, float n_new)
 {
-  Rule rule_with_condition{this->attribute_manager};
-  rule_with_condition.conditions.push_back(condition);
-
-  float p = cover(pos);
-  float n = cover(neg);
-  float p_new = rule_with_condition.cover(pos);
-  float n_new = rule_with_condition.cover(neg);
-
   if (((p + n) == 0) || (p == 0))
     return 0.0f;
   if (((p_new + n_new) == 0) || (p_new == 0))
@@ -62,74 +57,159 @@ float Rule::foil_gain(const Condition &condition, const std::list<Instance> &pos
   return p * (calc_val(p_new, n_new) - calc_val(p, n));
 }
 
-void Rule::grow(std::list<Instance> pos, std::list<Instance> neg)
+void Rule::grow(const Dataset& dataset, const RowView& pos, const RowView& neg, ThreadPool* pool)
 {
+  METRICS_PHASE(GROW);
+  TRACE_SCOPE("grow", "grow");
   if (!attribute_manager) {
     std::cout << "Attribute manager is not initialized. Can't grow rules without attributes!" << std::endl;
     return;
   }
 
+  Bitset pos_mask(dataset.size(), pos);
+  Bitset neg_mask(dataset.size(), neg);
+  Bitset covered = coverage(dataset);
+  size_t attr_count = attribute_manager->size();
+
   while (true) {
-    std::optional<float> max_gain;
-    Condition next_condition{};
-    auto attr_names = attribute_manager->getAttributeNames();
-    for (const auto& attr_name: attr_names) {
-      // do not allow duplicate conditions in one rule
-      if (attribute_manager->getAttributeType(attr_name) != CONTINUOUS && std::find_if(conditions.begin(), conditions.end(), [&attr_name](const auto& condition){return condition.attr_name == attr_name;}) != conditions.end())
-        continue;
-
-      auto attr_values = attribute_manager->getPossibleValues(attr_name);
-      for (const auto& attr_value: attr_values) {
-        Condition condition[2];
-        size_t num_of_conditions = (attribute_manager->getAttributeType(attr_name) == CONTINUOUS) ? 2 : 1;
-
-        if (attribute_manager->getAttributeType(attr_name) == CONTINUOUS) {
-          condition[0].attr_name = attr_name;
-          condition[0].attr_value = attr_value;
-          condition[0].cond_operator = LESS_EQ;
-
-          condition[1].attr_name = attr_name;
-          condition[1].attr_value = attr_value;
-          condition[1].cond_operator = MORE_EQ;
-        } else {
-          condition[0].attr_name = attr_name;
-          condition[0].attr_value = attr_value;
-          condition[0].cond_operator = EQ;
-        }
-
-        for (auto i = 0; i < num_of_conditions; ++i) {
-          auto gain = foil_gain(condition[i], pos, neg);
-          if (gain <= 0.0f)
-            continue; // this condition does not increase coverage - don't even consider
-
-          if (!max_gain.has_value() || gain > max_gain.value()) {
-            next_condition = condition[i];
-            max_gain = gain;
-          }
-        }
+    Candidate best;
+
+    // candidate conditions are scored on the grow instances the rule covers so far
+    Bitset covered_pos = pos_mask;
+    Bitset covered_neg = neg_mask;
+    covered_pos &= covered;
+    covered_neg &= covered;
+
+    // each attribute is scored independently, possibly on another thread
+    std::vector<Candidate> attr_best(attr_count);
+    auto score = [&](size_t i) {
+      AttributeId attr_id = i;
+      if (attribute_manager->getAttributeType(attr_id) == CONTINUOUS) {
+        scanThresholds(dataset, attr_id, covered_pos, covered_neg, attr_best[i]);
+        return;
       }
+
+      // do not allow duplicate conditions in one rule
+      if (std::find_if(conditions.begin(), conditions.end(), [attr_id](const auto& condition){return condition.attr_id == attr_id;}) != conditions.end())
+        return;
+
+      scanValues(dataset, attr_id, covered_pos, covered_neg, attr_best[i]);
+    };
+
+    if (pool) {
+      pool->parallelFor(attr_count, score);
+    } else {
+      for (size_t i = 0; i < attr_count; ++i)
+        score(i);
+    }
+
+    // reduce in attribute order, so the first of the equal gains wins as in a serial scan
+    for (const auto& candidate: attr_best) {
+      if (candidate.gain.has_value() && best.improvedBy(candidate.gain.value()))
+        best = candidate;
     }
-    if (next_condition.attr_name.empty())
+
+    if (!best.gain.has_value())
       return; // all possible conditions are added to the rule
       // throw std::runtime_error("no condition was selected for a rule");
 
-    conditions.push_back(next_condition);
+    conditions.push_back(best.condition);
+    covered &= BoundCondition(best.condition, dataset, *attribute_manager).mask(dataset.size());
 
-    if (cover(neg) == 0)
+    if (covered.countAnd(neg_mask) == 0)
       return;
   }
 }
 
+// scores every <= and >= threshold of a continuous attribute in one sweep over its sorted rows
+// instead of a coverage pass per threshold. Thresholds are the distinct values of the attribute, in increasing order
+void Rule::scanThresholds(const Dataset& dataset, AttributeId attr_id, const Bitset& covered_pos, const Bitset& covered_neg, Candidate& best) const
+{
+  size_t column = attribute_manager->getColumn(attr_id);
+  const auto& values = dataset.getContinuousColumn(column);
+  const auto& sorted_rows = dataset.getSortedRows(column);
+
+  // number of covered instances with a value below each distinct value
+  std::vector<float> thresholds;
+  std::vector<unsigned> below_p;
+  std::vector<unsigned> below_n;
+  unsigned cumulative_p = 0;
+  unsigned cumulative_n = 0;
+
+  for (size_t i = 0; i < sorted_rows.size(); ++i) {
+    auto row = sorted_rows[i];
+    if (i == 0 || values[row] != values[sorted_rows[i - 1]]) {
+      thresholds.push_back(values[row]);
+      below_p.push_back(cumulative_p);
+      below_n.push_back(cumulative_n);
+    }
+    cumulative_p += covered_pos.test(row);
+    cumulative_n += covered_neg.test(row);
+  }
+  below_p.push_back(cumulative_p);
+  below_n.push_back(cumulative_n);
+  METRICS_COUNT(ROWS_SCANNED, sorted_rows.size());
+  METRICS_COUNT(CANDIDATES, 2 * thresholds.size());
+
+  float p = covered_pos.count();
+  float n = covered_neg.count();
+  for (size_t i = 0; i < thresholds.size(); ++i) {
+    // attr <= threshold covers everything up to and including the threshold, attr >= threshold the rest
+    float gain[2] = {
+      foil_gain(p, n, below_p[i + 1], below_n[i + 1]),
+      foil_gain(p, n, cumulative_p - below_p[i], cumulative_n - below_n[i])
+    };
+    ConditionOperator cond_operator[2] = {LESS_EQ, MORE_EQ};
+
+    for (size_t j = 0; j < 2; ++j) {
+      if (best.improvedBy(gain[j])) {
+        best.condition = Condition{cond_operator[j], attr_id, thresholds[i]};
+        best.gain = gain[j];
+      }
+    }
+  }
+}
+
+// scores every == condition of a discrete attribute from a value -> (p, n) table
+// built in one pass over the covered instances, instead of a coverage pass per value
+void Rule::scanValues(const Dataset& dataset, AttributeId attr_id, const Bitset& covered_pos, const Bitset& covered_neg, Candidate& best) const
+{
+  size_t column = attribute_manager->getColumn(attr_id);
+  const auto& codes = dataset.getDiscreteColumn(column);
+  const auto& dictionary = dataset.getDictionary(column);
+
+  std::vector<unsigned> value_p(dictionary.size(), 0);
+  std::vector<unsigned> value_n(dictionary.size(), 0);
+  covered_pos.forEach([&codes, &value_p](size_t row){
+    if (codes[row] != Dataset::missing_code)
+      ++value_p[codes[row]];
+  });
+  covered_neg.forEach([&codes, &value_n](size_t row){
+    if (codes[row] != Dataset::missing_code)
+      ++value_n[codes[row]];
+  });
+
+  // codes follow the sorted order of the values
+  float p = covered_pos.count();
+  float n = covered_neg.count();
+  METRICS_COUNT(ROWS_SCANNED, p + n);
+  METRICS_COUNT(CANDIDATES, dictionary.size());
+  for (size_t code = 0; code < dictionary.size(); ++code) {
+    auto gain = foil_gain(p, n, value_p[code], value_n[code]);
+    if (best.improvedBy(gain)) {
+      best.condition = Condition{EQ, attr_id, dictionary[code]};
+      best.gain = gain;
+    }
+  }
+}
+
 float Rule::dl() const {
   float n = 0;
   float k = 0;
   float p_r = 0;
   float k_bits = 0;
 
-  for (const auto& attr_name: attribute_manager->getAttributeNames())
-    for (const auto& attr_value: attribute_manager->getPossibleValues(attr_name))
-      ++n;
-
+  n = attribute_manager->getValueCount();
   k = conditions.size();
   p_r = k / n;
   k_bits = std::ceil(std::log2(k + 1));
@@ -137,17 +217,27 @@ float Rule::dl() const {
   return std::ceil((k * std::log2(1/p_r) + (n - k) * std::log2(1 / (1 + p_r)) + k_bits) * 0.5);
 }
 
-float Rule::dl_err(const std::list<Instance>& pos, const std::list<Instance>& neg) const
+float Rule::dl_err(const Dataset& dataset, const RowView& pos, const RowView& neg) const
+{
+  return dl_err(coverage(dataset), Bitset(dataset.size(), pos), Bitset(dataset.size(), neg));
+}
+
+float Rule::dl_err(const Bitset& covered, const Bitset& pos, const Bitset& neg)
+{
+  return dl_err(covered.countAnd(pos), covered.countAnd(neg), pos.count(), neg.count());
+}
+
+float Rule::dl_err(unsigned covered_pos, unsigned covered_neg, size_t pos_size, size_t neg_size)
 {
   float p = 0;
   float fp = 0;
   float n = 0;
   float fn = 0;
 
-  p = cover(pos) + cover(neg);
-  fp = cover(neg);
-  n = (pos.size() + neg.size()) - p;
-  fn = pos.size() - cover(pos);
+  p = covered_pos + covered_neg;
+  fp = covered_neg;
+  n = (pos_size + neg_size) - p;
+  fn = pos_size - covered_pos;
 
   // TODO: store the result for debug, remove later
   auto result = MathUtils::log2_combination(p, fp) + MathUtils::log2_combination(n, fn);
@@ -164,8 +254,8 @@ std::string Rule::toString() const
 
   rule_str.append("IF ");
   for (auto it = this->conditions.cbegin(); it != this->conditions.cend(); std::advance(it, 1)) {
-    auto condition = *it;
-    rule_str.append(condition.attr_name);
+    const auto& condition = *it;
+    rule_str.append(attribute_manager->getName(condition.attr_id));
 
     switch (condition.cond_operator) {
       case EQ:
@@ -181,7 +271,7 @@ std::string Rule::toString() const
         break;
     }
 
-    if (attribute_manager->getAttributeType(condition.attr_name) == DISCRETE) {
+    if (attribute_manager->getAttributeType(condition.attr_id) == DISCRETE) {
       rule_str.append(std::get<std::string>(condition.attr_value));
     }
     else {
@@ -203,97 +293,49 @@ bool Rule::empty() const {
   return this->conditions.empty();
 }
 
-void Rule::prune(std::list<Instance> pos, std::list<Instance> neg)
+void Rule::prune(const Dataset& dataset, const RowView& pos, const RowView& neg)
 {
-  Rule tmp_rule(*this);
-  float p = cover(pos);
-  float n = cover(neg);
+  METRICS_PHASE(PRUNE);
+  TRACE_SCOPE("prune", "prune");
+  auto size = this->conditions.size();
+
+  // counts of every prefix of the rule, prefix i holds the first i conditions
+  // an instance whose first failing condition is f is covered by the prefixes 0..f
+  std::vector<unsigned> prefix_p(size + 1, 0);
+  std::vector<unsigned> prefix_n(size + 1, 0);
+  for (const auto failure: firstFailures(dataset, pos))
+    ++prefix_p[failure];
+  for (const auto failure: firstFailures(dataset, neg))
+    ++prefix_n[failure];
+  for (size_t i = size; i-- > 0;) {
+    prefix_p[i] += prefix_p[i + 1];
+    prefix_n[i] += prefix_n[i + 1];
+  }
+
+  float p = prefix_p[size];
+  float n = prefix_n[size];
   float max_metric = (p - n) / (p + n); // prune metric --> move to function
+  size_t keep = size;
 
-  if (this->conditions.size() == 1)
+  if (size == 1)
     return;
 
-  auto size = tmp_rule.conditions.size();
-  for (auto i = 0; i < size; ++i) {
-    tmp_rule.conditions.pop_back();
-
-    p = tmp_rule.cover(pos);
-    n = tmp_rule.cover(neg);
+  // try removing the last conditions one by one
+  for (size_t i = size; i-- > 0;) {
+    p = prefix_p[i];
+    n = prefix_n[i];
     float metric = (p - n) / (p + n); // prune metric
 
     if (metric > max_metric) {
       max_metric = metric;
-      conditions = tmp_rule.conditions;
+      keep = i;
     }
   }
-}
 
-void Rule::write_bin(std::ofstream& model_bin) const {
-  if (!model_bin.is_open())
-    throw std::runtime_error("Model file must be open!");
-
-  // structure:
-  //
-  // number of conditions
-  // |condition1|condition2|...|conditionN|
-  size_t number_of_conditions = this->conditions.size();
-  model_bin.write(reinterpret_cast<const char*>(&number_of_conditions), sizeof(this->conditions.size()));
-
-  for (const auto& condition: this->conditions) {
-    size_t name_len = condition.attr_name.size();
-
-    // |operator|name_len|name|value|
-    model_bin.write(reinterpret_cast<const char*>(&condition.cond_operator), sizeof(condition.cond_operator));
-    model_bin.write(reinterpret_cast<const char*>(&name_len), sizeof(name_len));
-    model_bin.write(condition.attr_name.c_str(), name_len);
-
-    if (attribute_manager->getAttributeType(condition.attr_name) == CONTINUOUS)
-      model_bin.write(reinterpret_cast<const char*>(&condition.attr_value), sizeof(condition.attr_value));
-    else {
-      size_t value_len = std::get<std::string>(condition.attr_value).size();
-
-      model_bin.write(reinterpret_cast<const char*>(&value_len), sizeof(value_len));
-      model_bin.write(std::get<std::string>(condition.attr_value).c_str(), value_len);
-    }
-  }
+  this->conditions.resize(keep);
 }
 
 
-void Rule::read_bin(std::ifstream& model_bin) {
-  if (!model_bin.is_open())
-    throw std::runtime_error("Model file must be open!");
-
-  size_t number_of_conditions = 0;
-
-  model_bin.read(reinterpret_cast<char*>(&number_of_conditions), sizeof(number_of_conditions));
-  while (number_of_conditions--) {
-    Condition condition;
-    size_t name_len = 0;
-
-    model_bin.read(reinterpret_cast<char*>(&condition.cond_operator), sizeof(condition.cond_operator));
-
-    model_bin.read(reinterpret_cast<char*>(&name_len), sizeof(name_len));
-    std::vector<char> buf(name_len);
-    model_bin.read(buf.data(), name_len);
-    buf.push_back('\0');
-    condition.attr_name = buf.data();
-
-    if (attribute_manager->getAttributeType(condition.attr_name) == CONTINUOUS)
-      model_bin.read(reinterpret_cast<char*>(&condition.attr_value), sizeof(condition.attr_value));
-    else {
-      size_t value_len = 0;
-      model_bin.read(reinterpret_cast<char*>(&value_len), sizeof(value_len));
-
-      buf = std::vector<char>(value_len);
-      model_bin.read(buf.data(), value_len);
-      buf.push_back('\0');
-      condition.attr_value = buf.data();
-    }
-
-    this->conditions.emplace_back(condition);
-  }
-}
-
 void Rule::addCondition(const Condition& condition) {
   this->conditions.push_back(condition);
 }
@@ -306,36 +348,35 @@ void Rule::removeAllConditions() {
   this->conditions.clear();
 }
 
-unsigned Rule::cover(const std::list<Instance>& instances) const
-{
-  unsigned count = 0;
+std::vector<BoundCondition> Rule::bind(const Dataset& dataset) const {
+  std::vector<BoundCondition> bound;
+  bound.reserve(this->conditions.size());
 
-  // an emptry rule covers all instances
-  if (this->conditions.empty())
-    return instances.size();
+  for (const auto& condition: this->conditions)
+    bound.emplace_back(condition, dataset, *this->attribute_manager);
 
-  for (const auto& instance: instances) {
-    // instance is covered if all conditions applied on this instance return true
-    // attributes not present in the list of conditions are ignored
+  return bound;
+}
 
-    bool covers = false;
+unsigned Rule::cover(const Dataset& dataset, const RowView& rows) const
+{
+  // an emptry rule covers all instances
+  if (this->conditions.empty())
+    return rows.size();
 
-    // TOOD: consider iterating over the single instance version of cover
-    for (const auto& condition: conditions) {
-      for (const auto& attr: instance.attributes) {
-        if (attr.name != condition.attr_name)
-          continue;
+  return coverage(dataset).countAnd(Bitset(dataset.size(), rows));
+}
 
-        covers = condition.apply(attr.value);
-        break;
-      }
-      if (!covers)
-        break;
-    }
-    count += covers;
-  }
+Bitset Rule::coverage(const Dataset& dataset) const
+{
+  METRICS_COUNT(COVER_CALLS, 1);
+  METRICS_COUNT(ROWS_SCANNED, dataset.size());
+  // instance is covered if all conditions applied on this instance return true
+  Bitset covered(dataset.size(), true);
+  for (const auto& condition: bind(dataset))
+    covered &= condition.mask(dataset.size());
 
-  return count;
+  return covered;
 }
 
 void Rule::copy(const Rule& anotherRule) {
@@ -343,35 +384,98 @@ void Rule::copy(const Rule& anotherRule) {
   this->conditions = anotherRule.conditions;
 }
 
-unsigned Rule::cover(const Instance& instance) const {
-  // instance is covered if all conditions applied on this instance return true
-  // attributes not present in the list of conditions are ignored
+std::vector<unsigned> Rule::firstFailures(const Dataset& dataset, const RowView& rows) const
+{
+  METRICS_COUNT(COVER_CALLS, 1);
+  METRICS_COUNT(ROWS_SCANNED, rows.size());
+  auto bound = bind(dataset);
+  std::vector<unsigned> failures;
+  failures.reserve(rows.size());
+
+  for (const auto row: rows) {
+    unsigned i = 0;
+    while (i < bound.size() && bound[i].apply(row))
+      ++i;
+    failures.push_back(i);
+  }
 
-  for (const auto& condition: conditions) {
-    for (const auto& attr: instance.attributes) {
-      if (attr.name != condition.attr_name)
-        continue;
+  return failures;
+}
 
-      if (!condition.apply(attr.value))
-        return false;
+RowView Rule::uncovered(const Dataset& dataset, const RowView& rows) const {
+  auto covered = coverage(dataset);
+  RowIds remaining;
+  remaining.reserve(rows.size());
+  std::copy_if(rows.begin(), rows.end(), std::back_inserter(remaining), [&covered](const auto row){return !covered.test(row);});
+  return RowView(std::move(remaining));
+}
+
+void Rule::compile(const Dataset& dataset, Program& program) const
+{
+  for (const auto& condition: this->conditions) {
+    Program::Op op{};
+    op.column = dataset.getColumn(this->attribute_manager->getName(condition.attr_id));
+    if (dataset.getAttributeType(op.column) != this->attribute_manager->getAttributeType(condition.attr_id))
+      throw std::runtime_error("Attribute " + this->attribute_manager->getName(condition.attr_id) + " has a different type in the dataset");
+
+    if (dataset.getAttributeType(op.column) == CONTINUOUS) {
+      Program::OpCode codes[] = {Program::CONTINUOUS_EQ, Program::CONTINUOUS_LESS_EQ, Program::CONTINUOUS_MORE_EQ};
+      op.code = codes[condition.cond_operator];
+      op.threshold = std::get<float>(condition.attr_value);
+    } else {
+      Program::OpCode codes[] = {Program::DISCRETE_EQ, Program::DISCRETE_LESS_EQ, Program::DISCRETE_MORE_EQ};
+      op.code = codes[condition.cond_operator];
+      op.value = dataset.encode(op.column, std::get<std::string>(condition.attr_value));
+      if (op.value == Dataset::missing_code)
+        op.code = Program::NEVER;
     }
+
+    program.addOp(op);
   }
 
-  return true;
+  program.endRule();
 }
 
-bool Condition::apply(const AttributeValue attr_value) const
+BoundCondition::BoundCondition(const Condition& condition, const Dataset& dataset, const AttributeManager& attribute_manager)
+  : cond_operator(condition.cond_operator)
+  , continuous(nullptr)
+  , discrete(nullptr)
+  , threshold(0.0f)
+  , code(Dataset::missing_code)
 {
-  switch (this->cond_operator) {
-    case EQ:
-      return attr_value == this->attr_value;
-    case LESS_EQ:
-      return attr_value <= this->attr_value;
-    case MORE_EQ:
-      return attr_value >= this->attr_value;
-    default:
-      // throw something
-      return false;
+  size_t column = attribute_manager.getColumn(condition.attr_id);
+
+  if (dataset.getAttributeType(column) == CONTINUOUS) {
+    this->continuous = dataset.getContinuousColumn(column).data();
+    this->threshold = std::get<float>(condition.attr_value);
+  } else {
+    this->discrete = dataset.getDiscreteColumn(column).data();
+    this->code = dataset.encode(column, std::get<std::string>(condition.attr_value));
   }
-  return false;
+}
+
+Bitset BoundCondition::mask(size_t size) const
+{
+  if (this->continuous) {
+    switch (this->cond_operator) {
+      case EQ:
+        return Bitset::equal(this->continuous, size, this->threshold);
+      case LESS_EQ:
+        return Bitset::lessEqual(this->continuous, size, this->threshold);
+      case MORE_EQ:
+        return Bitset::moreEqual(this->continuous, size, this->threshold);
+      default:
+        return Bitset(size);
+    }
+  }
+
+  if (this->cond_operator == EQ)
+    return Bitset::equal(this->discrete, size, this->code);
+
+  // ordered comparisons of discrete values are never produced by grow, no vector kernel for them
+  Bitset mask(size);
+  for (size_t row = 0; row < size; ++row)
+    if (apply(row))
+      mask.set(row);
+  return mask;
 }
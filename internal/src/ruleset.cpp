@@ -1,4 +1,7 @@
 #include "../header/rule.h"
+#include "../header/mdl.h"
+#include "../header/metrics.h"
+#include "../header/trace.h"
 #include <numeric>
 #include <stdexcept>
 #include <algorithm>
@@ -27,18 +30,9 @@ void Ruleset::replaceRule(RuleHandle handle, const Rule& rule) {
   this->rules[handle.id].copy(rule);
 }
 
-float Ruleset::dl(std::list<Instance> pos, std::list<Instance> neg) const
+float Ruleset::dl(const Dataset& dataset, const RowView& pos, const RowView& neg) const
 {
-  float dl_sum = 0.0f;
-
-  for (const auto& rule: this->rules) {
-    dl_sum += rule.dl() + rule.dl_err(pos, neg);
-
-    pos.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
-    neg.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
-  }
-
-  return dl_sum;
+  return DLEvaluator(dataset, pos, neg, *this).dl();
 }
 
 std::vector<Ruleset::RuleHandle> Ruleset::get() const {
@@ -69,52 +63,106 @@ std::string Ruleset::toString() const
   return rules_str;
 }
 
-void Ruleset::pruneRule(RuleHandle handle, std::list<Instance> pos, std::list<Instance> neg) {
-  // TODO: there is a lot of copying in this function, please optimize it
+void Ruleset::pruneRule(RuleHandle handle, const Dataset& dataset, const RowView& pos, const RowView& neg) {
+  METRICS_PHASE(PRUNE);
+  TRACE_SCOPE("prune", "prune in ruleset");
+  // the rule is pruned to the prefix that gives the smallest error DL of the whole ruleset on the pruning instances
+  // every prefix is evaluated from a single pass over the instances: for every instance the rule's first failing
+  // condition is found once, then the counts every rule needs are accumulated per failure index and summed per prefix
 
   if (handle.id >= this->rules.size())
     throw std::runtime_error("Rule is not present in the rule set");
 
-  Rule rule(this->rules[handle.id]);
-  float min_metric = std::numeric_limits<float>::max();
-  unsigned conditions_removed = 0;
-  unsigned conditions_to_remove = 0;
+  const Rule& pruned = this->rules[handle.id];
+  size_t size = pruned.size();
+  if (size == 0)
+    return;
 
-  while (!this->rules[handle.id].empty()) {
-    float dl_err = 0.0f;
-    for (const auto& rule: this->rules) {
-      dl_err += rule.dl_err(pos, neg);
+  // the rules before the pruned rule do not depend on the prefix
+  float dl_err_before = 0.0f;
+  Bitset pos_mask(dataset.size(), pos);
+  Bitset neg_mask(dataset.size(), neg);
+  for (size_t i = 0; i < handle.id; ++i) {
+    auto covered = this->rules[i].coverage(dataset);
+    dl_err_before += Rule::dl_err(covered, pos_mask, neg_mask);
+    pos_mask.andNot(covered);
+    neg_mask.andNot(covered);
+  }
 
-      pos.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
-      neg.remove_if([&rule](const Instance& instance){return rule.cover(instance);});
-    }
-    if (dl_err < min_metric) {
-      min_metric = dl_err;
-      conditions_to_remove = conditions_removed;
+  // the instances that reach the pruned rule
+  RowIds reaching;
+  std::vector<bool> is_pos;
+  pos_mask.forEach([&reaching, &is_pos](size_t row){reaching.push_back(row); is_pos.push_back(true);});
+  neg_mask.forEach([&reaching, &is_pos](size_t row){reaching.push_back(row); is_pos.push_back(false);});
+  const RowView rows(std::move(reaching));
+  auto failures = pruned.firstFailures(dataset, rows);
+
+  // dl_err[k] - error DL of the ruleset when the pruned rule keeps its first k conditions
+  std::vector<float> dl_err(size + 1, dl_err_before);
+
+  // pruned rule: an instance is covered by the prefix k if its failure index is >= k
+  std::vector<unsigned> covered_pos(size + 1, 0);
+  std::vector<unsigned> covered_neg(size + 1, 0);
+  size_t pos_size = pos_mask.count();
+  size_t neg_size = neg_mask.count();
+  for (size_t r = 0; r < rows.size(); ++r)
+    ++(is_pos[r] ? covered_pos : covered_neg)[failures[r]];
+  for (size_t k = size; k-- > 0;) {
+    covered_pos[k] += covered_pos[k + 1];
+    covered_neg[k] += covered_neg[k + 1];
+  }
+  for (size_t k = 1; k <= size; ++k)
+    dl_err[k] += Rule::dl_err(covered_pos[k], covered_neg[k], pos_size, neg_size);
+
+  // following rules: an instance reaches them under the prefix k if its failure index is < k
+  // and no rule in between covers it
+  std::vector<bool> removed(rows.size(), false);
+  for (size_t i = handle.id + 1; i < this->rules.size(); ++i) {
+    auto covered = this->rules[i].coverage(dataset);
+    std::vector<unsigned> reach_pos(size + 1, 0);
+    std::vector<unsigned> reach_neg(size + 1, 0);
+    std::fill(covered_pos.begin(), covered_pos.end(), 0);
+    std::fill(covered_neg.begin(), covered_neg.end(), 0);
+
+    for (size_t r = 0; r < rows.size(); ++r) {
+      if (removed[r])
+        continue;
+
+      // counted in the prefixes failures[r] + 1..size
+      bool is_covered = covered.test(rows[r]);
+      ++(is_pos[r] ? reach_pos : reach_neg)[failures[r]];
+      if (is_covered) {
+        ++(is_pos[r] ? covered_pos : covered_neg)[failures[r]];
+        removed[r] = true;
+      }
     }
 
-    this->rules[handle.id].removeLastCondition();
-    ++conditions_removed;
+    unsigned cumulative[4] = {0, 0, 0, 0};
+    for (size_t k = 1; k <= size; ++k) {
+      cumulative[0] += reach_pos[k - 1];
+      cumulative[1] += reach_neg[k - 1];
+      cumulative[2] += covered_pos[k - 1];
+      cumulative[3] += covered_neg[k - 1];
+      dl_err[k] += Rule::dl_err(cumulative[2], cumulative[3], cumulative[0], cumulative[1]);
+    }
   }
 
-  // swap the temporary with the original rule
-  this->rules[handle.id].copy(rule);
+  // keep the longest of the prefixes with the smallest error, the empty rule is not considered
+  float min_metric = std::numeric_limits<float>::max();
+  size_t conditions_to_remove = 0;
+  for (size_t k = size; k >= 1; --k) {
+    if (dl_err[k] < min_metric) {
+      min_metric = dl_err[k];
+      conditions_to_remove = size - k;
+    }
+  }
 
   // prune
   for (size_t i = 0; i < conditions_to_remove; ++i)
     this->rules[handle.id].removeLastCondition();
 }
 
-bool Ruleset::cover(const Instance& instance) {
-  for (const auto& rule: this->rules) {
-    if (rule.cover(instance))
-      return true;
-  }
-
-  return false;
-}
-
-void Ruleset::simplify(std::list<Instance> pos, std::list<Instance> neg) {
+void Ruleset::simplify(const RowView& pos, const RowView& neg) {
   if (this->rules.size() <= 1)
     return;
 
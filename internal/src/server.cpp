@@ -0,0 +1,198 @@
+#include "../header/server.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIPPERK_SOCKETS
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+Server::LoadedModel::LoadedModel(const std::string& path)
+  : time(std::filesystem::last_write_time(path))
+  , file(path)
+  , schema(file.getSchema())
+{}
+
+Server::Server(const std::string& path_to_model_bin)
+  : path_to_model_bin(path_to_model_bin)
+  , model(std::make_shared<const LoadedModel>(path_to_model_bin))
+  , watcher(&Server::watch, this)
+{}
+
+Server::~Server() {
+  {
+    std::lock_guard<std::mutex> lock(this->watcher_mutex);
+    this->stopping = true;
+  }
+  this->watcher_wakeup.notify_all();
+  this->watcher.join();
+}
+
+void Server::watch() {
+  auto seen = std::atomic_load(&this->model)->time;
+
+  std::unique_lock<std::mutex> lock(this->watcher_mutex);
+  while (!this->watcher_wakeup.wait_for(lock, reload_interval, [this]{return this->stopping;})) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(this->path_to_model_bin, error);
+    if (error || time == seen)
+      continue;
+    seen = time;
+
+    // a model that fails to load is reported and the one being served is kept
+    try {
+      std::shared_ptr<const LoadedModel> loaded = std::make_shared<const LoadedModel>(this->path_to_model_bin);
+      std::atomic_store(&this->model, std::move(loaded));
+    } catch (const std::exception& e) {
+      std::cerr << "Failed to reload the model: " << e.what() << std::endl;
+    }
+  }
+}
+
+#ifdef RIPPERK_SOCKETS
+
+static void writeAll(int output, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = ::write(output, data.data() + written, data.size() - written);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      throw std::runtime_error("Failed to send the reply");
+    written += count;
+  }
+}
+
+void Server::serve(int input, int output) {
+  std::string received;
+  std::string header;
+  std::shared_ptr<const LoadedModel> current;
+  std::unique_ptr<RowParser> parser;
+  Program program;
+  Dataset batch;
+  std::vector<std::string_view> lines;
+  std::vector<std::uint32_t> classes;
+  std::string reply;
+
+  auto classify = [&]() {
+    // the model is picked per batch, so a swapped model is used from the next batch on
+    auto latest = std::atomic_load(&this->model);
+    if (latest != current) {
+      current = std::move(latest);
+      parser = std::make_unique<RowParser>(current->schema, header);
+      program = current->file.compileForSchema(parser->getLayout());
+    }
+
+    parser->parse(lines, batch);
+    program.bind(batch);
+    classes.resize(lines.size());
+    program.classify(0, lines.size(), classes.data());
+
+    reply.clear();
+    for (const auto class_index: classes) {
+      reply += program.getClassName(class_index);
+      reply += '\n';
+    }
+    writeAll(output, reply);
+    lines.clear();
+  };
+
+  // every complete line received so far joins the batch
+  auto take = [&](std::string_view text) {
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      if (end == std::string_view::npos)
+        end = text.size();
+      auto line = text.substr(start, end - start);
+      start = end + 1;
+
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      if (line.empty())
+        continue;
+
+      if (header.empty()) {
+        header = line;
+        continue;
+      }
+      lines.push_back(line);
+      if (lines.size() == max_batch_rows)
+        classify();
+    }
+    if (!lines.empty())
+      classify();
+  };
+
+  char chunk[1 << 16];
+  while (true) {
+    ssize_t count = ::read(input, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      break;
+    received.append(chunk, count);
+
+    size_t complete = received.rfind('\n');
+    if (complete == std::string::npos)
+      continue;
+    take(std::string_view(received).substr(0, complete + 1));
+    received.erase(0, complete + 1);
+  }
+
+  take(received); // a last row without a line break
+}
+
+void Server::listen(const std::string& path_to_socket) {
+  std::signal(SIGPIPE, SIG_IGN); // a client leaving must not end the server
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path_to_socket.size() >= sizeof(address.sun_path))
+    throw std::runtime_error("Socket path is too long: " + path_to_socket);
+  std::memcpy(address.sun_path, path_to_socket.c_str(), path_to_socket.size() + 1);
+
+  // a socket left behind by an earlier server is replaced, any other file is not
+  if (std::filesystem::is_socket(path_to_socket))
+    std::filesystem::remove(path_to_socket);
+
+  int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      ::listen(listener, SOMAXCONN) != 0)
+    throw std::runtime_error("Failed to listen on the socket " + path_to_socket + ": " + std::strerror(errno));
+
+  while (true) {
+    int client = ::accept(listener, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      throw std::runtime_error(std::string("Failed to accept a client: ") + std::strerror(errno));
+    }
+
+    std::thread([this, client]() {
+      try {
+        serve(client, client);
+      } catch (const std::exception& e) {
+        std::cerr << "Client dropped: " << e.what() << std::endl;
+      }
+      ::close(client);
+    }).detach();
+  }
+}
+
+#else
+
+void Server::serve(int input, int output) {
+  throw std::runtime_error("Serving is not supported on this platform");
+}
+
+void Server::listen(const std::string& path_to_socket) {
+  throw std::runtime_error("Serving is not supported on this platform");
+}
+
+#endif
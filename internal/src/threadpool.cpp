@@ -0,0 +1,114 @@
+#include "../header/threadpool.h"
+#include "../header/metrics.h"
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <algorithm>
+
+namespace {
+  // shared by the caller and the helpers of one parallelFor
+  // helpers that start after the loop is finished find no work left and only touch this state
+  struct Loop {
+    const std::function<void(size_t)>* body;
+    size_t n;
+    std::atomic<size_t> next{0};
+    size_t done = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+#ifdef RIPPERK_METRICS
+    Metrics::Record* metrics; // class of the caller, the helpers work for it too
+#endif
+
+    void run() {
+      for (size_t i = next++; i < n; i = next++) {
+        std::exception_ptr thrown;
+        try {
+          (*body)(i);
+        } catch (...) {
+          thrown = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (thrown && !error)
+          error = thrown;
+        if (++done == n)
+          finished.notify_all();
+      }
+    }
+  };
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (size_t i = 1; i < threads; ++i)
+    this->workers.emplace_back([this]{work();});
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->task_available.notify_all();
+
+  for (auto& worker: this->workers)
+    worker.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->task_available.wait(lock, [this]{return this->stopping || !this->tasks.empty();});
+      if (this->tasks.empty())
+        return; // stopping
+      task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& body) {
+  if (n == 0)
+    return;
+
+  if (this->workers.empty() || n == 1) {
+    for (size_t i = 0; i < n; ++i)
+      body(i);
+    return;
+  }
+
+  auto loop = std::make_shared<Loop>();
+  loop->body = &body;
+  loop->n = n;
+#ifdef RIPPERK_METRICS
+  loop->metrics = Metrics::current();
+#endif
+
+  size_t helpers = std::min(this->workers.size(), n - 1);
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (size_t i = 0; i < helpers; ++i)
+#ifdef RIPPERK_METRICS
+      this->tasks.emplace_back([loop]{Metrics::Scope scope(loop->metrics); loop->run();});
+#else
+      this->tasks.emplace_back([loop]{loop->run();});
+#endif
+  }
+  if (helpers == 1)
+    this->task_available.notify_one();
+  else
+    this->task_available.notify_all();
+
+  loop->run();
+
+  std::unique_lock<std::mutex> lock(loop->mutex);
+  loop->finished.wait(lock, [&loop]{return loop->done == loop->n;});
+  if (loop->error)
+    std::rethrow_exception(loop->error);
+}
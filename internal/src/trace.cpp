@@ -0,0 +1,88 @@
+#include "../header/trace.h"
+#include "../header/json.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> Trace::recording{false};
+
+namespace {
+  struct Event {
+    const char* category; // nullptr for end events, they close the last open event of the thread
+    std::string name;
+    std::chrono::steady_clock::time_point time;
+  };
+
+  // events of one thread, in the order they happened
+  struct Buffer {
+    size_t thread_id; // small number shown by the viewer, in the order the threads recorded their first event
+    std::vector<Event> events;
+  };
+
+  std::chrono::steady_clock::time_point origin;
+  std::mutex buffers_mutex;
+  std::vector<std::unique_ptr<Buffer>> buffers; // outlive their threads, so events of finished threads are kept
+  thread_local Buffer* thread_buffer = nullptr;
+
+  Buffer& threadBuffer() {
+    if (!thread_buffer) {
+      std::lock_guard<std::mutex> lock(buffers_mutex);
+      buffers.push_back(std::make_unique<Buffer>(Buffer{buffers.size(), {}}));
+      thread_buffer = buffers.back().get();
+    }
+    return *thread_buffer;
+  }
+}
+
+void Trace::start() {
+  origin = std::chrono::steady_clock::now();
+  recording.store(true, std::memory_order_relaxed);
+}
+
+Trace::Scope::Scope(const char* category, std::string name)
+  : recorded(enabled())
+{
+  if (this->recorded)
+    threadBuffer().events.push_back(Event{category, std::move(name), std::chrono::steady_clock::now()});
+}
+
+Trace::Scope::~Scope() {
+  if (this->recorded)
+    threadBuffer().events.push_back(Event{nullptr, std::string(), std::chrono::steady_clock::now()});
+}
+
+void Trace::write(const std::string& path) {
+  std::ofstream output(path);
+  if (!output.is_open())
+    throw std::runtime_error("Failed to write the trace " + path);
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  char timestamp[32];
+  bool first = true;
+  output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  for (const auto& buffer: buffers) {
+    auto thread = std::to_string(buffer->thread_id);
+    output << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread
+           << ", \"args\": {\"name\": \"thread " << thread << "\"}}";
+    first = false;
+
+    for (const auto& event: buffer->events) {
+      // microseconds since start()
+      std::snprintf(timestamp, sizeof(timestamp), "%.3f", std::chrono::duration<double, std::micro>(event.time - origin).count());
+      if (event.category)
+        output << ",\n{\"name\": " << Json::quote(event.name) << ", \"cat\": \"" << event.category << "\", \"ph\": \"B\", \"ts\": " << timestamp;
+      else
+        output << ",\n{\"ph\": \"E\", \"ts\": " << timestamp;
+      output << ", \"pid\": 1, \"tid\": " << thread << "}";
+    }
+  }
+  output << "\n]}\n";
+
+  if (!output.good())
+    throw std::runtime_error("Failed to write the trace " + path);
+}
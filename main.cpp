@@ -3,6 +3,8 @@
 #include <map>
 #include <string>
 #include "header/ripperk.h"
+#include "internal/header/metrics.h"
+#include "internal/header/trace.h"
 
 int main(int argc, char* argv[])
 {
@@ -47,12 +49,23 @@ int main(int argc, char* argv[])
             std::cout << "\tlearn - train and output the model. Paths to the dataset CSV and the model output file are requred" << std::endl;
             std::cout << "\tevaluate - check the accuracy of the model. Paths to the model and the test dataset CSV are required" << std::endl;
             std::cout << "\tclassify - classify a dataset. Paths to the model and the dataset CSV are required" << std::endl;
+            std::cout << "\tserve - classify instances sent over a Unix domain socket, or over stdin and stdout, one per line after a CSV header. The model is reloaded when its file changes. Path to the model is required" << std::endl;
+            std::cout << "\tcrossval - train and evaluate a model on every split of the dataset into folds, the folds are trained concurrently. Path to the dataset CSV is required" << std::endl;
+            std::cout << "\tsweep - train a model for every combination of the given ratios and k values in one process and rank them by accuracy and description length. Path to the dataset CSV is required" << std::endl;
+            std::cout << "\tconvert - parse the dataset CSV once and store it as a binary cache. Paths to the dataset CSV and the cache output file are required" << std::endl;
 
-        std::cout << "--dataset - path to the CSV file holding the data instances. Should be formatted appropriately" << std::endl;
+        std::cout << "--dataset - path to the CSV file holding the data instances. Should be formatted appropriately. A binary cache created in the convert mode can be used in place of the CSV" << std::endl;
+        std::cout << "--cache - path to the binary cache created in the convert mode" << std::endl;
+        std::cout << "--socket - path to the Unix domain socket the serve mode listens on. Non-mandatory. Stdin and stdout are used if not given" << std::endl;
         std::cout << "--model - path to the binary file storing the model. The model will be created in the learn mode; evaluate and classify modes require the existing and valid model file" << std::endl;
         std::cout << "--model-txt - path to the text file holding the model in the human-readable format. Non-mandatory" << std::endl;
-        std::cout << "--ratio - ratio of grow to prune dataset. Non-mandatory. Default is 2/3" << std::endl;
-        std::cout << "--k - number of times the optimization is performed. Non-mandatory. Default is 2" << std::endl;
+        std::cout << "--ratio - ratio of grow to prune dataset. The sweep mode takes several values. Non-mandatory. Default is 2/3" << std::endl;
+        std::cout << "--k - number of times the optimization is performed. The sweep mode takes several values. Non-mandatory. Default is 2" << std::endl;
+        std::cout << "--test - path to the dataset CSV the sweep mode measures the accuracy on. Non-mandatory. The training dataset is used if not given" << std::endl;
+        std::cout << "--folds - number of folds of the crossval mode. Non-mandatory. Default is 10" << std::endl;
+        std::cout << "--metrics - path to the JSON file the time of every training phase and the hot path counters are written to, in total and per class. Non-mandatory. Only available in builds with RIPPERK_METRICS defined" << std::endl;
+        std::cout << "--trace - path to the JSON file a timeline of the training is written to, in the Chrome trace event format. It holds every class, IREP rule, grow and prune call and optimize iteration, per thread. Non-mandatory" << std::endl;
+        std::cout << "--threads - number of threads used for training, 0 uses all hardware threads. Non-mandatory. Default is 0" << std::endl;
 
         return 0;
     }
@@ -67,36 +80,77 @@ int main(int argc, char* argv[])
         return 1;
     }
     std::string mode = params["--mode"][0];
-    if ((mode != "learn") && (mode != "evaluate") && (mode != "classify")) {
+    if ((mode != "learn") && (mode != "evaluate") && (mode != "classify") && (mode != "convert") && (mode != "serve") && (mode != "crossval") && (mode != "sweep")) {
         std::cerr << "Incorrect mode " << mode << " is provided" << std::endl;
         return 1;
     }
 
-    // validate and save path to dataset
-    if (params.find("--dataset") == params.end()) {
-        std::cerr << "Mandatory parameter dataset is missing" << std::endl;
-        return 1;
+    // validate and save path to dataset. The serve mode gets the instances from its clients
+    std::filesystem::path path_to_dataset = "";
+    if (mode != "serve") {
+        if (params.find("--dataset") == params.end()) {
+            std::cerr << "Mandatory parameter dataset is missing" << std::endl;
+            return 1;
+        }
+        if (params["--dataset"].empty()) {
+            std::cerr << "No dataset is provided" << std::endl;
+            return 1;
+        }
+        path_to_dataset = params["--dataset"][0];
+        if (path_to_dataset.is_relative())
+            path_to_dataset = exe_path.generic_string() + path_to_dataset.generic_string();
     }
-    if (params["--dataset"].empty()) {
-        std::cerr << "No dataset is provided" << std::endl;
-        return 1;
+
+    // validate and save number of threads. Non-mandatory, the default is only reported below, after the modes that print nothing
+    unsigned threads = 0;
+    bool default_threads = params.find("--threads") == params.end() || params["--threads"].empty();
+    if (!default_threads) {
+        size_t pos = 0;
+        threads = std::stoul(params.at("--threads")[0], &pos);
     }
-    std::filesystem::path path_to_dataset = params["--dataset"][0];
-    if (path_to_dataset.is_relative())
-        path_to_dataset = exe_path.generic_string() + path_to_dataset.generic_string();
 
-    // validate and save path to model bin
-    if (params.find("--model") == params.end()) {
-        std::cerr << "Mandatory parameter model is missing" << std::endl;
-        return 1;
+    // the convert mode only needs the path to the cache
+    if (mode == "convert") {
+        if (params.find("--cache") == params.end() || params["--cache"].empty()) {
+            std::cerr << "Mandatory parameter cache is missing" << std::endl;
+            return 1;
+        }
+        std::filesystem::path path_to_cache = params["--cache"][0];
+        if (path_to_cache.is_relative())
+            path_to_cache = exe_path.generic_string() + path_to_cache.generic_string();
+
+        RIPPERk(path_to_dataset.generic_string(), "", "", 2/(float)3, 2, threads).convert(path_to_cache.generic_string());
+        return 0;
     }
-    if (params["--model"].empty()) {
-        std::cerr << "No model is provided" << std::endl;
-        return 1;
+
+    // validate and save path to model bin. The crossval and sweep modes keep their models in memory
+    std::filesystem::path path_to_model_bin = "";
+    if (mode != "crossval" && mode != "sweep") {
+        if (params.find("--model") == params.end()) {
+            std::cerr << "Mandatory parameter model is missing" << std::endl;
+            return 1;
+        }
+        if (params["--model"].empty()) {
+            std::cerr << "No model is provided" << std::endl;
+            return 1;
+        }
+        path_to_model_bin = params["--model"][0];
+        if (path_to_model_bin.is_relative())
+            path_to_model_bin = exe_path.generic_string() + path_to_model_bin.generic_string();
+    }
+
+    // the serve mode only needs the model and the socket. Nothing else may be printed, stdout can carry the replies
+    if (mode == "serve") {
+        std::filesystem::path path_to_socket = "";
+        if (params.find("--socket") != params.end() && !params["--socket"].empty()) {
+            path_to_socket = params["--socket"][0];
+            if (path_to_socket.is_relative())
+                path_to_socket = exe_path.generic_string() + path_to_socket.generic_string();
+        }
+
+        RIPPERk(path_to_dataset.generic_string(), "", path_to_model_bin.generic_string()).serve(path_to_socket.generic_string());
+        return 0;
     }
-    std::filesystem::path path_to_model_bin = params["--model"][0];
-    if (path_to_model_bin.is_relative())
-        path_to_model_bin = exe_path.generic_string() + path_to_model_bin.generic_string();
 
     // validate and save path to model txt. Non-mandatory
     std::filesystem::path path_to_model_txt = "";
@@ -110,8 +164,9 @@ int main(int argc, char* argv[])
             path_to_model_txt = exe_path.generic_string() + path_to_model_txt.generic_string();
     }
 
-    // validate and save pruning ratio. Non-mandatory
+    // validate and save pruning ratio. Non-mandatory, the sweep mode takes all the values
     float pruning_ratio = 2/(float)3;
+    std::vector<float> pruning_ratios;
     if (params.find("--ratio") == params.end() || params["--ratio"].empty()) {
         std::cout << "Using default pruning ratio of 2/3" << std::endl;
         std::cout << "If you wish to use a different ratio, provide the value with the --ratio parameter" << std::endl;
@@ -119,10 +174,15 @@ int main(int argc, char* argv[])
     } else {
         size_t pos = 0;
         pruning_ratio = std::stof(params.at("--ratio")[0], &pos);
+        for (const auto& value: params.at("--ratio"))
+            pruning_ratios.push_back(std::stof(value, &pos));
     }
+    if (pruning_ratios.empty())
+        pruning_ratios.push_back(pruning_ratio);
 
-    // validate and save k. Non-mandatory
+    // validate and save k. Non-mandatory, the sweep mode takes all the values
     int k = 2;
+    std::vector<int> ks;
     if (params.find("--k") == params.end() || params["--k"].empty()) {
         std::cout << "Using default k of 2" << std::endl;
         std::cout << "If you wish to use a different k, provide the value with the --k parameter" << std::endl;
@@ -130,16 +190,73 @@ int main(int argc, char* argv[])
     } else {
         size_t pos = 0;
         k = std::stoi(params.at("--k")[0], &pos);
+        for (const auto& value: params.at("--k"))
+            ks.push_back(std::stoi(value, &pos));
+    }
+    if (ks.empty())
+        ks.push_back(k);
+
+    if (default_threads) {
+        std::cout << "Using all hardware threads" << std::endl;
+        std::cout << "If you wish to use a different number of threads, provide the value with the --threads parameter" << std::endl;
+        std::cout << std::endl;
+    }
+
+    // validate and save number of folds. Non-mandatory, only used by the crossval mode
+    size_t folds = 10;
+    if (mode == "crossval" && params.find("--folds") != params.end() && !params["--folds"].empty()) {
+        size_t pos = 0;
+        folds = std::stoul(params.at("--folds")[0], &pos);
     }
 
-    auto ripperk = RIPPERk(path_to_dataset.generic_string(), path_to_model_txt.generic_string(), path_to_model_bin.generic_string(), pruning_ratio, k);
+    // validate and save path to the test dataset. Non-mandatory, only used by the sweep mode
+    std::filesystem::path path_to_test_dataset = "";
+    if (mode == "sweep" && params.find("--test") != params.end() && !params["--test"].empty()) {
+        path_to_test_dataset = params["--test"][0];
+        if (path_to_test_dataset.is_relative())
+            path_to_test_dataset = exe_path.generic_string() + path_to_test_dataset.generic_string();
+    }
+
+    // validate and save path to the metrics output. Non-mandatory, the metrics are compiled out of builds without RIPPERK_METRICS
+    std::filesystem::path path_to_metrics = "";
+    if (params.find("--metrics") != params.end() && !params["--metrics"].empty()) {
+#ifndef RIPPERK_METRICS
+        std::cerr << "Metrics are not built in. Build with RIPPERK_METRICS defined to use the --metrics parameter" << std::endl;
+        return 1;
+#endif
+        path_to_metrics = params["--metrics"][0];
+        if (path_to_metrics.is_relative())
+            path_to_metrics = exe_path.generic_string() + path_to_metrics.generic_string();
+    }
+
+    // validate and save path to the trace output. Non-mandatory
+    std::filesystem::path path_to_trace = "";
+    if (params.find("--trace") != params.end() && !params["--trace"].empty()) {
+        path_to_trace = params["--trace"][0];
+        if (path_to_trace.is_relative())
+            path_to_trace = exe_path.generic_string() + path_to_trace.generic_string();
+        Trace::start();
+    }
+
+    auto ripperk = RIPPERk(path_to_dataset.generic_string(), path_to_model_txt.generic_string(), path_to_model_bin.generic_string(), pruning_ratio, k, threads);
 
     if (mode == "learn")
         ripperk.fit();
     else if (mode == "evaluate")
         ripperk.evaluate();
+    else if (mode == "crossval")
+        ripperk.crossval(folds);
+    else if (mode == "sweep")
+        ripperk.sweep(pruning_ratios, ks, path_to_test_dataset.generic_string());
     else
         ripperk.classify();
 
+#ifdef RIPPERK_METRICS
+    if (!path_to_metrics.empty())
+        Metrics::write(path_to_metrics.generic_string());
+#endif
+    if (!path_to_trace.empty())
+        Trace::write(path_to_trace.generic_string());
+
     return 0;
 }
\ No newline at end of file